@@ -0,0 +1,140 @@
+#pragma once
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include "OnlyPoints.h"
+
+// Midpoint circle offsets keyed by radius. A circle only depends on its radius up to a
+// translation, so the pixels around (0, 0) are generated once and every later circle of
+// that radius is the stored offsets plus the rounded origin, added 4 floats at a time.
+// Output is identical to Bresenham::genCircleData. The least recently used radii are
+// dropped once more than maxFloats floats are stored.
+class CircleCache
+{
+public:
+    explicit CircleCache(const size_t _maxFloats = size_t(1) << 20)
+        : maxFloats(_maxFloats), storedFloats(0) {}
+
+    // 3D float offsets of the circle around (0, 0). The reference stays valid until the
+    // next call that has to generate a radius.
+    const std::vector<float>& offsets(const int R) {
+        auto found = entries.find(R);
+        if (found != entries.end()) {
+            recent.splice(recent.begin(), recent, found->second.lru);
+            return found->second.offsets;
+        }
+
+        recent.push_front(R);
+        Entry& entry = entries[R];
+        entry.offsets = Bresenham::genCircleData(Point(0.0f, 0.0f), R);
+        entry.lru = recent.begin();
+        storedFloats += entry.offsets.size();
+        // Never evict the entry we are about to return
+        while (storedFloats > maxFloats && recent.size() > 1) {
+            auto evicted = entries.find(recent.back());
+            storedFloats -= evicted->second.offsets.size();
+            entries.erase(evicted);
+            recent.pop_back();
+        }
+        return entry.offsets;
+    }
+
+    size_t circleDataSize(const int R) {
+        return offsets(R).size();
+    }
+
+    // Same output as Bresenham::genCircleData, return the end of the written range
+    float* genCircleData(const Point& origin, const int R, float* out) {
+        const std::vector<float>& src = offsets(R);
+        const IPoint o = toPixel(origin);
+        stamp(src.data(), src.size(), static_cast<float>(o.x), static_cast<float>(o.y), out);
+        return out + src.size();
+    }
+
+    template <typename OutIt>
+    OutIt genCircleData(const Point& origin, const int R, OutIt out) {
+        const std::vector<float>& src = offsets(R);
+        const IPoint o = toPixel(origin);
+        for (size_t i = 0; i < src.size(); i += 3) {
+            *out++ = src[i] + o.x;
+            *out++ = src[i + 1] + o.y;
+            *out++ = 0.0f;
+        }
+        return out;
+    }
+
+    std::vector<float> genCircleData(const Point& origin, const int R) {
+        std::vector<float> data(circleDataSize(R));
+        genCircleData(origin, R, data.data());
+        return data;
+    }
+
+    // Circles that are fully inside clip are stamped, the rest go through the clipped generator
+    size_t circleDataSize(const Point& origin, const int R, const bbox& clip) {
+        if (isInside(origin, R, clip)) {
+            return circleDataSize(R);
+        }
+        return Bresenham::circleDataSize(origin, R, clip);
+    }
+
+    template <typename OutIt>
+    OutIt genCircleData(const Point& origin, const int R, const bbox& clip, OutIt out) {
+        if (isInside(origin, R, clip)) {
+            return genCircleData(origin, R, out);
+        }
+        return Bresenham::genCircleData(origin, R, clip, out);
+    }
+
+    std::vector<float> genCircleData(const Point& origin, const int R, const bbox& clip) {
+        if (isInside(origin, R, clip)) {
+            return genCircleData(origin, R);
+        }
+        return Bresenham::genCircleData(origin, R, clip);
+    }
+
+    size_t size() const { return entries.size(); }
+    size_t floats() const { return storedFloats; }
+
+    void clear() {
+        entries.clear();
+        recent.clear();
+        storedFloats = 0;
+    }
+
+private:
+    struct Entry {
+        std::vector<float> offsets;
+        std::list<int>::iterator lru;
+    };
+
+    size_t maxFloats, storedFloats;
+    std::unordered_map<int, Entry> entries;
+    // Radii, most recently used first
+    std::list<int> recent;
+
+    static bool isInside(const Point& origin, const int R, const bbox& clip) {
+        const IPoint o = toPixel(origin);
+        return o.x - R >= clip.xmin && o.x + R <= clip.xmax && o.y - R >= clip.ymin && o.y + R <= clip.ymax;
+    }
+
+    // out[i] = src[i] + (ox, oy, 0) repeated. Three xyz triples fill three SSE registers,
+    // so the origin is laid out as three rotating patterns.
+    static void stamp(const float* src, const size_t n, const float ox, const float oy, float* out) {
+        size_t i = 0;
+#if ONLYPOINTS_SIMD_WIDTH >= 4
+        const __m128 a = _mm_setr_ps(ox, oy, 0.0f, ox);
+        const __m128 b = _mm_setr_ps(oy, 0.0f, ox, oy);
+        const __m128 c = _mm_setr_ps(0.0f, ox, oy, 0.0f);
+        for (; i + 12 <= n; i += 12) {
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(src + i), a));
+            _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_loadu_ps(src + i + 4), b));
+            _mm_storeu_ps(out + i + 8, _mm_add_ps(_mm_loadu_ps(src + i + 8), c));
+        }
+#endif
+        for (; i < n; i += 3) {
+            out[i] = src[i] + ox;
+            out[i + 1] = src[i + 1] + oy;
+            out[i + 2] = src[i + 2];
+        }
+    }
+};
@@ -0,0 +1,321 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include "OnlyPoints.h"
+
+// Pack a color as RGBA8, byte order in memory is R, G, B, A
+uint32_t packRGBA(const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t a = 255) {
+    return uint32_t(r) | (uint32_t(g) << 8) | (uint32_t(b) << 16) | (uint32_t(a) << 24);
+}
+
+// A CPU color target for the rasterizers in OnlyPoints.h, packed RGBA8.
+// Pixel (0, 0) is the bottom-left corner like an OpenGL texture, while the screen
+// coordinates used by OnlyPoints.h put (0, 0) at the center, see originX() / originY().
+// plot() and fillSpan() take screen coordinates and drop whatever is off the framebuffer.
+// Writes through plot(), fillSpan(), fillRect() and clear() grow the dirty rectangle, so a
+// display only has to upload what changed. setPixel() does not, it is the raw access for
+// code that writes from several threads and marks the dirty area itself.
+class Framebuffer
+{
+public:
+    int width, height;
+    std::vector<uint32_t> pixels;
+    // In framebuffer coordinates, only valid when hasDirty is true
+    bbox dirty;
+    bool hasDirty;
+
+    Framebuffer(const int _width, const int _height, const uint32_t color = 0)
+        : width(_width), height(_height), pixels(size_t(_width) * _height, color), hasDirty(false) {
+        markDirty(0, 0, width - 1, height - 1);
+    }
+
+    int originX() const { return width / 2; }
+    int originY() const { return height / 2; }
+
+    bool contains(const int x, const int y) const {
+        return x >= 0 && y >= 0 && x < width && y < height;
+    }
+
+    void clear(const uint32_t color) {
+        std::fill(pixels.begin(), pixels.end(), color);
+        markDirty(0, 0, width - 1, height - 1);
+    }
+
+    void markDirty(const int xmin, const int ymin, const int xmax, const int ymax) {
+        if (!hasDirty) {
+            dirty.xmin = xmin;
+            dirty.ymin = ymin;
+            dirty.xmax = xmax;
+            dirty.ymax = ymax;
+            hasDirty = true;
+            return;
+        }
+        dirty.xmin = std::min(dirty.xmin, xmin);
+        dirty.ymin = std::min(dirty.ymin, ymin);
+        dirty.xmax = std::max(dirty.xmax, xmax);
+        dirty.ymax = std::max(dirty.ymax, ymax);
+    }
+
+    void resetDirty() {
+        hasDirty = false;
+    }
+
+    // r is in framebuffer coordinates and is clamped to the framebuffer
+    void fillRect(const bbox& r, const uint32_t color) {
+        const int x0 = std::max(r.xmin, 0);
+        const int x1 = std::min(r.xmax, width - 1);
+        const int y0 = std::max(r.ymin, 0);
+        const int y1 = std::min(r.ymax, height - 1);
+        if (x0 > x1 || y0 > y1) {
+            return;
+        }
+        for (int y = y0; y <= y1; ++y) {
+            std::fill(pixels.begin() + size_t(y) * width + x0, pixels.begin() + size_t(y) * width + x1 + 1, color);
+        }
+        markDirty(x0, y0, x1, y1);
+    }
+
+    // x, y are framebuffer coordinates and must be inside the framebuffer
+    void setPixel(const int x, const int y, const uint32_t color) {
+        pixels[size_t(y) * width + x] = color;
+    }
+
+    uint32_t getPixel(const int x, const int y) const {
+        return pixels[size_t(y) * width + x];
+    }
+
+    void plot(const int sx, const int sy, const uint32_t color) {
+        const int x = sx + originX();
+        const int y = sy + originY();
+        if (contains(x, y)) {
+            setPixel(x, y, color);
+            markDirty(x, y, x, y);
+        }
+    }
+
+    void fillSpan(const int sy, const int sx0, const int sx1, const uint32_t color) {
+        const int y = sy + originY();
+        const int x0 = std::max(sx0 + originX(), 0);
+        const int x1 = std::min(sx1 + originX(), width - 1);
+        if (y < 0 || y >= height || x0 > x1) {
+            return;
+        }
+        std::fill(pixels.begin() + size_t(y) * width + x0, pixels.begin() + size_t(y) * width + x1 + 1, color);
+        markDirty(x0, y, x1, y);
+    }
+};
+
+// A 1-bit coverage target, same coordinate conventions as Framebuffer.
+// Every row starts on a new 64-bit word, bit i of a word is pixel (64 * word + i).
+class CoverageBuffer
+{
+public:
+    int width, height;
+    int wordsPerRow;
+    std::vector<uint64_t> words;
+
+    CoverageBuffer(const int _width, const int _height)
+        : width(_width), height(_height), wordsPerRow((_width + 63) / 64),
+          words(size_t((_width + 63) / 64) * _height, 0) {}
+
+    int originX() const { return width / 2; }
+    int originY() const { return height / 2; }
+
+    bool contains(const int x, const int y) const {
+        return x >= 0 && y >= 0 && x < width && y < height;
+    }
+
+    void clear(const bool covered) {
+        std::fill(words.begin(), words.end(), covered ? ~uint64_t(0) : uint64_t(0));
+    }
+
+    // x, y are framebuffer coordinates and must be inside the buffer
+    void setPixel(const int x, const int y, const bool covered) {
+        uint64_t& word = words[size_t(y) * wordsPerRow + x / 64];
+        const uint64_t bit = uint64_t(1) << (x % 64);
+        word = covered ? (word | bit) : (word & ~bit);
+    }
+
+    bool getPixel(const int x, const int y) const {
+        return (words[size_t(y) * wordsPerRow + x / 64] >> (x % 64)) & 1;
+    }
+
+    void plot(const int sx, const int sy, const bool covered) {
+        const int x = sx + originX();
+        const int y = sy + originY();
+        if (contains(x, y)) {
+            setPixel(x, y, covered);
+        }
+    }
+
+    // Set or clear a whole run a word at a time
+    void fillSpan(const int sy, const int sx0, const int sx1, const bool covered) {
+        const int y = sy + originY();
+        const int x0 = std::max(sx0 + originX(), 0);
+        const int x1 = std::min(sx1 + originX(), width - 1);
+        if (y < 0 || y >= height || x0 > x1) {
+            return;
+        }
+        uint64_t* row = &words[size_t(y) * wordsPerRow];
+        for (int w = x0 / 64; w <= x1 / 64; ++w) {
+            const int lo = std::max(x0 - 64 * w, 0);
+            const int hi = std::min(x1 - 64 * w, 63);
+            const uint64_t mask = (hi == 63 ? ~uint64_t(0) : (uint64_t(1) << (hi + 1)) - 1) & ~((uint64_t(1) << lo) - 1);
+            row[w] = covered ? (row[w] | mask) : (row[w] & ~mask);
+        }
+    }
+};
+
+// A float depth target, same coordinate conventions as Framebuffer. Smaller is closer,
+// clear() to 1 (the far plane) before a frame.
+class DepthBuffer
+{
+public:
+    int width, height;
+    std::vector<float> depth;
+
+    DepthBuffer(const int _width, const int _height, const float value = 1.0f)
+        : width(_width), height(_height), depth(size_t(_width) * _height, value) {}
+
+    int originX() const { return width / 2; }
+    int originY() const { return height / 2; }
+
+    bool contains(const int x, const int y) const {
+        return x >= 0 && y >= 0 && x < width && y < height;
+    }
+
+    void clear(const float value = 1.0f) {
+        std::fill(depth.begin(), depth.end(), value);
+    }
+
+    // x, y are framebuffer coordinates and must be inside the buffer
+    void setPixel(const int x, const int y, const float z) {
+        depth[size_t(y) * width + x] = z;
+    }
+
+    float getPixel(const int x, const int y) const {
+        return depth[size_t(y) * width + x];
+    }
+
+    // GL_LESS: store z and return true if it is closer than what is there
+    bool testAndSet(const int x, const int y, const float z) {
+        float& stored = depth[size_t(y) * width + x];
+        if (z < stored) {
+            stored = z;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Rasterize straight into a Framebuffer or CoverageBuffer, no point list in between.
+// value is the color for a Framebuffer and true / false for a CoverageBuffer.
+namespace Draw {
+    // Output iterator that fills every Span written to it
+    template <typename Target, typename Value>
+    struct SpanWriter {
+        Target* target;
+        Value value;
+
+        SpanWriter(Target& _target, const Value _value) : target(&_target), value(_value) {}
+        SpanWriter& operator * () { return *this; }
+        SpanWriter& operator ++ () { return *this; }
+        SpanWriter& operator ++ (int) { return *this; }
+        SpanWriter& operator = (const Span& s) {
+            target->fillSpan(s.y, s.x0, s.x1, value);
+            return *this;
+        }
+    };
+
+    // The target's pixels in screen coordinates
+    template <typename Target>
+    bbox screenRect(const Target& target) {
+        return Clipping::viewport(target.width, target.height);
+    }
+
+    // clip is in screen coordinates, only the pixels inside it and the target are drawn
+    template <typename Target, typename Value>
+    void line(Target& target, const Point& v0, const Point& v1, const Value value, const bbox& clip) {
+        Bresenham::plotLine(v0, v1, Clipping::intersect(clip, screenRect(target)), [&target, value](const int x, const int y) {
+            target.plot(x, y, value);
+        });
+    }
+
+    template <typename Target, typename Value>
+    void line(Target& target, const Point& v0, const Point& v1, const Value value) {
+        line(target, v0, v1, value, screenRect(target));
+    }
+
+    template <typename Target, typename Value>
+    void circle(Target& target, const Point& origin, const int R, const Value value, const bool isfill = false) {
+        if (isfill) {
+            Bresenham::genFilledCircleSpans(origin, R, screenRect(target), SpanWriter<Target, Value>(target, value));
+        }
+        Bresenham::plotCircle(origin, R, screenRect(target), [&target, value](const int x, const int y) {
+            target.plot(x, y, value);
+        });
+    }
+
+    // Angles in radians, counterclockwise from +x, see Bresenham::ArcRange
+    template <typename Target, typename Value>
+    void arc(Target& target, const Point& origin, const int R, const double start, const double end, const Value value) {
+        Bresenham::plotArc(origin, R, start, end, screenRect(target), [&target, value](const int x, const int y) {
+            target.plot(x, y, value);
+        });
+    }
+
+    template <typename Target, typename Value>
+    void ellipse(Target& target, const Point& origin, const int rx, const int ry, const Value value) {
+        Bresenham::plotEllipse(origin, rx, ry, screenRect(target), [&target, value](const int x, const int y) {
+            target.plot(x, y, value);
+        });
+    }
+
+    template <typename Target, typename Value>
+    void ellipseArc(Target& target, const Point& origin, const int rx, const int ry, const double start,
+                    const double end, const Value value) {
+        Bresenham::plotEllipseArc(origin, rx, ry, start, end, screenRect(target), [&target, value](const int x, const int y) {
+            target.plot(x, y, value);
+        });
+    }
+
+    // Filled polygon, rule is PolygonRasterization::EVEN_ODD or NON_ZERO
+    template <typename Target, typename Value>
+    void polygon(Target& target, const std::vector<Point>& vertices, const Value value,
+                 const int rule = PolygonRasterization::EVEN_ODD) {
+        PolygonRasterization::genPolygonSpans(vertices, rule, screenRect(target), SpanWriter<Target, Value>(target, value));
+    }
+
+    // Redrawing a triangle inside clip only touches the pixels inside clip, so a moved triangle
+    // can be updated by clearing and redrawing the union of its old and new bounds
+    template <typename Target, typename Value>
+    void triangle(Target& target, const Point& p0, const Point& p1, const Point& p2, const Value value,
+                  const bool isfill, const bbox& clip) {
+        line(target, p0, p1, value, clip);
+        line(target, p0, p2, value, clip);
+        line(target, p1, p2, value, clip);
+
+        if (isfill) {
+            // Only scan the part of the bbox that is on the target
+            TriangleRasterization::scanTriangleSpansClipped(p0, p1, p2, Clipping::intersect(clip, screenRect(target)),
+                [&target, value](const int y, const int x0, const int x1) {
+                    target.fillSpan(y, x0, x1, value);
+                });
+        }
+    }
+
+    template <typename Target, typename Value>
+    void triangle(Target& target, const Point& p0, const Point& p1, const Point& p2, const Value value,
+                  const bool isfill = false) {
+        triangle(target, p0, p1, p2, value, isfill, screenRect(target));
+    }
+
+    // Screen pixels triangle() can touch, the outline ends may be half a pixel past the vertices
+    bbox triangleBounds(const Point& p0, const Point& p1, const Point& p2) {
+        bbox b;
+        TriangleRasterization::bound3(p0, p1, p2, b);
+        return Clipping::widen(b, 1);
+    }
+}
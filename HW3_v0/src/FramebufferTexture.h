@@ -0,0 +1,98 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstring>
+#include "shader.h"
+#include "Framebuffer.h"
+#include "StreamBuffer.h"
+
+// Show a CPU Framebuffer as one fullscreen textured quad.
+// upload() only sends the dirty rectangle: the rows are copied into a pixel unpack
+// buffer and glTexSubImage2D reads from it, so the cost depends on what changed and
+// drawing costs the same no matter how many pixels are covered. The unpack buffer is a
+// StreamBuffer, so a new upload never waits for the GPU to finish reading the previous one.
+class FramebufferTexture
+{
+public:
+    GLuint texture, VAO, VBO;
+    StreamBuffer PBO;
+    int width, height;
+
+    FramebufferTexture(const int _width, const int _height)
+        : PBO(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(_width) * _height * sizeof(uint32_t)), width(_width), height(_height) {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // position, texture coordinate
+        GLfloat quad[] = {
+            -1.0f, -1.0f, 0.0f, 0.0f,
+            1.0f, -1.0f, 1.0f, 0.0f,
+            1.0f, 1.0f, 1.0f, 1.0f,
+            -1.0f, -1.0f, 0.0f, 0.0f,
+            1.0f, 1.0f, 1.0f, 1.0f,
+            -1.0f, 1.0f, 0.0f, 1.0f
+        };
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    // fb must have the same size as the texture
+    void upload(Framebuffer& fb) {
+        if (!fb.hasDirty) {
+            return;
+        }
+        const bbox& d = fb.dirty;
+        const int w = d.xmax - d.xmin + 1;
+        const int h = d.ymax - d.ymin + 1;
+        const GLsizeiptr size = GLsizeiptr(w) * h * sizeof(uint32_t);
+
+        GLintptr offset;
+        uint32_t* dst = (uint32_t*)PBO.map(size, offset);
+        if (dst != NULL) {
+            for (int y = 0; y < h; ++y) {
+                memcpy(dst + size_t(y) * w, &fb.pixels[size_t(d.ymin + y) * fb.width + d.xmin], w * sizeof(uint32_t));
+            }
+            PBO.unmap();
+
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, d.xmin, d.ymin, w, h, GL_RGBA, GL_UNSIGNED_BYTE, (void*)offset);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            fb.resetDirty();
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // Delete the GL objects, call it before the context goes away
+    void release() {
+        PBO.release();
+        glDeleteTextures(1, &texture);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+    }
+
+    void draw(Shader& shader) {
+        shader.use();
+        shader.setInt("screenTexture", 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+};
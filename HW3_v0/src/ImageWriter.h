@@ -0,0 +1,178 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "Framebuffer.h"
+
+// Dump a Framebuffer or CoverageBuffer to disk, no GL context needed.
+// Images are written top row first, so what you see matches the window.
+// Covered pixels of a CoverageBuffer are black, like the PBM convention.
+// Every writer returns false if the file could not be opened, written or closed.
+namespace ImageWriter {
+    bool writePPM(const Framebuffer& fb, const std::string& path) {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file == NULL) {
+            return false;
+        }
+        bool ok = fprintf(file, "P6\n%d %d\n255\n", fb.width, fb.height) > 0;
+        std::vector<uint8_t> row(3 * size_t(fb.width));
+        for (int y = fb.height - 1; y >= 0 && ok; --y) {
+            for (int x = 0; x < fb.width; ++x) {
+                const uint32_t c = fb.getPixel(x, y);
+                row[3 * x] = c & 0xff;
+                row[3 * x + 1] = (c >> 8) & 0xff;
+                row[3 * x + 2] = (c >> 16) & 0xff;
+            }
+            ok = fwrite(row.data(), 1, row.size(), file) == row.size();
+        }
+        // close even after a failed write
+        const bool closed = fclose(file) == 0;
+        return ok && closed;
+    }
+
+    // Binary PBM
+    bool writePPM(const CoverageBuffer& cb, const std::string& path) {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file == NULL) {
+            return false;
+        }
+        bool ok = fprintf(file, "P4\n%d %d\n", cb.width, cb.height) > 0;
+        std::vector<uint8_t> row((size_t(cb.width) + 7) / 8);
+        for (int y = cb.height - 1; y >= 0 && ok; --y) {
+            std::fill(row.begin(), row.end(), 0);
+            for (int x = 0; x < cb.width; ++x) {
+                if (cb.getPixel(x, y)) {
+                    row[x / 8] |= 0x80 >> (x % 8);
+                }
+            }
+            ok = fwrite(row.data(), 1, row.size(), file) == row.size();
+        }
+        // close even after a failed write
+        const bool closed = fclose(file) == 0;
+        return ok && closed;
+    }
+
+    struct CrcTable {
+        uint32_t v[256];
+
+        CrcTable() {
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                v[n] = c;
+            }
+        }
+    };
+
+    uint32_t crc32(const uint8_t* data, const size_t size, uint32_t crc = 0) {
+        static const CrcTable table;
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i) {
+            crc = table.v[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    void putU32(std::vector<uint8_t>& out, const uint32_t v) {
+        out.push_back(uint8_t(v >> 24));
+        out.push_back(uint8_t(v >> 16));
+        out.push_back(uint8_t(v >> 8));
+        out.push_back(uint8_t(v));
+    }
+
+    bool writeChunk(FILE* file, const char* type, const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> chunk;
+        putU32(chunk, uint32_t(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        // the CRC covers the type and the data, not the length
+        putU32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+        return fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+    }
+
+    // raw holds the filtered scanlines (a 0 filter byte in front of every row).
+    // They go into a zlib stream of stored deflate blocks, which keeps the writer tiny.
+    bool writePNGData(const std::string& path, const int width, const int height,
+                      const uint8_t bitDepth, const uint8_t colorType, const std::vector<uint8_t>& raw) {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (file == NULL) {
+            return false;
+        }
+        const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        bool ok = fwrite(signature, 1, 8, file) == 8;
+
+        std::vector<uint8_t> header;
+        putU32(header, uint32_t(width));
+        putU32(header, uint32_t(height));
+        header.push_back(bitDepth);
+        header.push_back(colorType);
+        header.push_back(0); // compression
+        header.push_back(0); // filter
+        header.push_back(0); // interlace
+        ok = ok && writeChunk(file, "IHDR", header);
+
+        std::vector<uint8_t> zlib;
+        zlib.push_back(0x78);
+        zlib.push_back(0x01);
+        const size_t maxBlock = 65535;
+        size_t pos = 0;
+        do {
+            const size_t len = std::min(maxBlock, raw.size() - pos);
+            zlib.push_back(pos + len == raw.size() ? 1 : 0);
+            zlib.push_back(uint8_t(len));
+            zlib.push_back(uint8_t(len >> 8));
+            zlib.push_back(uint8_t(~len));
+            zlib.push_back(uint8_t(~len >> 8));
+            zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+            pos += len;
+        } while (pos < raw.size());
+
+        uint32_t a = 1, b = 0;
+        for (const uint8_t byte : raw) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        putU32(zlib, (b << 16) | a);
+        ok = ok && writeChunk(file, "IDAT", zlib);
+        ok = ok && writeChunk(file, "IEND", std::vector<uint8_t>());
+        const bool closed = fclose(file) == 0;
+        return ok && closed;
+    }
+
+    // RGBA with alpha forced to 255: the framebuffer alpha is not coverage, and viewers would
+    // show pixels cleared to 0 as transparent
+    bool writePNG(const Framebuffer& fb, const std::string& path) {
+        const size_t stride = 4 * size_t(fb.width) + 1;
+        std::vector<uint8_t> raw(stride * fb.height, 0);
+        for (int y = 0; y < fb.height; ++y) {
+            uint8_t* row = &raw[stride * (fb.height - 1 - y) + 1];
+            for (int x = 0; x < fb.width; ++x) {
+                const uint32_t c = fb.getPixel(x, y);
+                row[4 * x] = c & 0xff;
+                row[4 * x + 1] = (c >> 8) & 0xff;
+                row[4 * x + 2] = (c >> 16) & 0xff;
+                row[4 * x + 3] = 0xff;
+            }
+        }
+        return writePNGData(path, fb.width, fb.height, 8, 6, raw);
+    }
+
+    // 1-bit grayscale, 0 is black
+    bool writePNG(const CoverageBuffer& cb, const std::string& path) {
+        const size_t stride = (size_t(cb.width) + 7) / 8 + 1;
+        std::vector<uint8_t> raw(stride * cb.height, 0);
+        for (int y = 0; y < cb.height; ++y) {
+            uint8_t* row = &raw[stride * (cb.height - 1 - y) + 1];
+            for (int x = 0; x < cb.width; ++x) {
+                if (!cb.getPixel(x, y)) {
+                    row[x / 8] |= 0x80 >> (x % 8);
+                }
+            }
+        }
+        return writePNGData(path, cb.width, cb.height, 1, 0, raw);
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <vector>
+#include "OnlyPoints.h"
+#include "Parallel.h"
+
+// Batch line rasterization for large numbers of independent segments (wireframes, plots).
+// The segments are split into chunks that threads pick up one at a time. Every segment's output
+// size is known up front, so an exclusive prefix sum gives each segment its exact place in one
+// shared buffer: threads write disjoint ranges, and the output is in segment order whatever the
+// thread count.
+namespace LineBatch {
+    const int DEFAULT_CHUNK_SIZE = 1024;
+
+    // Structure of arrays, segment i runs from (x0[i], y0[i]) to (x1[i], y1[i])
+    struct Segments {
+        std::vector<float> x0, y0, x1, y1;
+
+        size_t size() const { return x0.size(); }
+
+        void reserve(const size_t n) {
+            x0.reserve(n);
+            y0.reserve(n);
+            x1.reserve(n);
+            y1.reserve(n);
+        }
+
+        void clear() {
+            x0.clear();
+            y0.clear();
+            x1.clear();
+            y1.clear();
+        }
+
+        void push_back(const Point& v0, const Point& v1) {
+            x0.push_back(v0.x);
+            y0.push_back(v0.y);
+            x1.push_back(v1.x);
+            y1.push_back(v1.y);
+        }
+
+        Point start(const size_t i) const { return Point(x0[i], y0[i]); }
+        Point end(const size_t i) const { return Point(x1[i], y1[i]); }
+    };
+
+    // Fill data with the 3D floats of every segment, in segment order. offsets[i] is where segment
+    // i starts in data and offsets[n] the total. size(v0, v1) and gen(v0, v1, out) are the
+    // per-segment generator. data and offsets are only resized, so reusing them across frames
+    // avoids the per-segment vectors of Bresenham::genLineData.
+    template <typename Size, typename Gen>
+    void genLineData(const Segments& segments, std::vector<float>& data, std::vector<size_t>& offsets,
+                     Size size, Gen gen, const unsigned threads = 0, const int chunkSize = DEFAULT_CHUNK_SIZE) {
+        const size_t n = segments.size();
+        const int chunks = int((n + chunkSize - 1) / chunkSize);
+        offsets.resize(n + 1);
+
+        // Pass 1: size of every segment and of every chunk
+        std::vector<size_t> chunkBase(chunks + 1, 0);
+        Parallel::parallelFor(chunks, [&](const int c) {
+            const size_t first = size_t(c) * chunkSize;
+            const size_t last = std::min(first + chunkSize, n);
+            size_t total = 0;
+            for (size_t i = first; i < last; ++i) {
+                // The count sits in the segment's own slot until pass 2 replaces it by the offset
+                offsets[i] = size(segments.start(i), segments.end(i));
+                total += offsets[i];
+            }
+            chunkBase[c + 1] = total;
+        }, threads);
+
+        // Exclusive scan over the chunks, then each chunk scans its own segments from its base
+        for (int c = 0; c < chunks; ++c) {
+            chunkBase[c + 1] += chunkBase[c];
+        }
+        data.resize(chunkBase[chunks]);
+
+        // Pass 2: local scan and generation into the segment's own range
+        Parallel::parallelFor(chunks, [&](const int c) {
+            const size_t first = size_t(c) * chunkSize;
+            const size_t last = std::min(first + chunkSize, n);
+            size_t offset = chunkBase[c];
+            for (size_t i = first; i < last; ++i) {
+                const size_t count = offsets[i];
+                offsets[i] = offset;
+                gen(segments.start(i), segments.end(i), data.data() + offset);
+                offset += count;
+            }
+        }, threads);
+        offsets[n] = chunkBase[chunks];
+    }
+
+    void genLineData(const Segments& segments, std::vector<float>& data, std::vector<size_t>& offsets,
+                     const unsigned threads = 0) {
+        genLineData(segments, data, offsets,
+            [](const Point& v0, const Point& v1) { return Bresenham::lineDataSize(v0, v1); },
+            [](const Point& v0, const Point& v1, float* out) { Bresenham::genLineData(v0, v1, out); },
+            threads);
+    }
+
+    // Only the pixels inside clip
+    void genLineData(const Segments& segments, const bbox& clip, std::vector<float>& data,
+                     std::vector<size_t>& offsets, const unsigned threads = 0) {
+        genLineData(segments, data, offsets,
+            [&clip](const Point& v0, const Point& v1) { return Bresenham::lineDataSize(v0, v1, clip); },
+            [&clip](const Point& v0, const Point& v1, float* out) { Bresenham::genLineData(v0, v1, clip, out); },
+            threads);
+    }
+
+    std::vector<float> genLineData(const Segments& segments, const unsigned threads = 0) {
+        std::vector<float> data;
+        std::vector<size_t> offsets;
+        genLineData(segments, data, offsets, threads);
+        return data;
+    }
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a file through the virtual memory system, for inputs larger than RAM.
+// Only one window of the file is mapped at a time, so the address space and the pages the
+// process holds stay bounded whatever the file size. Moving the window unmaps the old one.
+class MappedFile
+{
+public:
+    MappedFile() : fileSize(0), view(NULL), viewSize(0) {
+#ifdef _WIN32
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#else
+        fd = -1;
+#endif
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            close();
+            return false;
+        }
+        fileSize = uint64_t(size.QuadPart);
+        // An empty file cannot be mapped, there is nothing to read anyway
+        if (fileSize > 0) {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping == NULL) {
+                close();
+                return false;
+            }
+        }
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close();
+            return false;
+        }
+        fileSize = uint64_t(st.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+        unmap();
+#ifdef _WIN32
+        if (mapping != NULL) {
+            CloseHandle(mapping);
+            mapping = NULL;
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+#endif
+        fileSize = 0;
+    }
+
+    uint64_t size() const { return fileSize; }
+
+    // Map [offset, offset + length) and return a pointer to offset, NULL on failure or if the
+    // range is not inside the file. The pointer is valid until the next map() or close().
+    const uint8_t* map(const uint64_t offset, const size_t length) {
+        unmap();
+        if (length == 0 || offset > fileSize || length > fileSize - offset) {
+            return NULL;
+        }
+        // Views have to start on the allocation granularity
+        const uint64_t start = offset - offset % granularity();
+        viewSize = size_t(offset - start) + length;
+#ifdef _WIN32
+        view = MapViewOfFile(mapping, FILE_MAP_READ, DWORD(start >> 32), DWORD(start & 0xffffffffu), viewSize);
+        if (view == NULL) {
+            viewSize = 0;
+            return NULL;
+        }
+#else
+        void* p = mmap(NULL, viewSize, PROT_READ, MAP_PRIVATE, fd, off_t(start));
+        if (p == MAP_FAILED) {
+            viewSize = 0;
+            return NULL;
+        }
+        view = p;
+        // The window is read front to back once
+        madvise(view, viewSize, MADV_SEQUENTIAL);
+#endif
+        return static_cast<const uint8_t*>(view) + (offset - start);
+    }
+
+    void unmap() {
+        if (view == NULL) {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(view);
+#else
+        munmap(view, viewSize);
+#endif
+        view = NULL;
+        viewSize = 0;
+    }
+
+    static uint64_t granularity() {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwAllocationGranularity;
+#else
+        return uint64_t(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator = (const MappedFile&);
+
+    uint64_t fileSize;
+    void* view;
+    size_t viewSize;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#else
+    int fd;
+#endif
+};
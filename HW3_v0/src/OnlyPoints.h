@@ -1,27 +1,78 @@
 #pragma once
 #include <cmath>
+#include <cstdint>
 #include<vector>
 #include<iostream>
 #include<algorithm>
+#include<iterator>
+
+// Width of the edge test in TriangleRasterization::scanTriangle, define it as 1 to force the scalar loop
+#ifndef ONLYPOINTS_SIMD_WIDTH
+#if defined(__AVX__)
+#define ONLYPOINTS_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ONLYPOINTS_SIMD_WIDTH 4
+#else
+#define ONLYPOINTS_SIMD_WIDTH 1
+#endif
+#endif
+
+#if ONLYPOINTS_SIMD_WIDTH == 8
+#include <immintrin.h>
+#elif ONLYPOINTS_SIMD_WIDTH == 4
+#include <emmintrin.h>
+#endif
 
 // Basic structure
-struct Point {
-    float x, y;
+template <typename T>
+struct BasicPoint {
+    T x, y;
 
-    bool operator == (const Point& rhs) const {
+    bool operator == (const BasicPoint& rhs) const {
         return (this->x == rhs.x) && (this->y == rhs.y);
     }
-    void operator = (const Point& p) {
-        x = p.x;
-        y = p.y;
-    }
-    Point(float _x, float _y) : x(_x), y(_y) {}
+    BasicPoint() : x(0), y(0) {}
+    BasicPoint(T _x, T _y) : x(_x), y(_y) {}
 };
 
+// Point is what the GUI hands us, IPoint is a whole pixel.
+// The Bresenham cores also take IPoint in 28.4 fixed point (1/16 pixel), see toFixed().
+typedef BasicPoint<float> Point;
+typedef BasicPoint<int32_t> IPoint;
+
+const int FIXED_SHIFT = 4;
+const int32_t FIXED_ONE = 1 << FIXED_SHIFT;
+// Largest |coordinate| in pixels that survives toFixed. The fixed values and their differences
+// then fit in int32 and the int64 error terms of the Bresenham cores cannot overflow.
+const int32_t FIXED_LIMIT = 1 << 25;
+
+// Round to 28.4 fixed point, clamping to +-FIXED_LIMIT (NaN goes to the lower limit)
+int32_t toFixed(const double v) {
+    const double limit = double(FIXED_LIMIT) * FIXED_ONE;
+    const double f = v * FIXED_ONE;
+    return static_cast<int32_t>(std::lround(f > -limit ? (f < limit ? f : limit) : -limit));
+}
+
+IPoint toFixed(const Point& p) {
+    return IPoint(toFixed(double(p.x)), toFixed(double(p.y)));
+}
+
+// Round a float point to the nearest pixel
+IPoint toPixel(const Point& p) {
+    return IPoint(static_cast<int32_t>(std::lround(p.x)), static_cast<int32_t>(std::lround(p.y)));
+}
+
 struct bbox {
     int xmin, xmax, ymin, ymax;
 };
 
+// A run of pixels from x0 to x1 (inclusive) on row y
+struct Span {
+    int y, x0, x1;
+
+    Span(int _y, int _x0, int _x1) : y(_y), x0(_x0), x1(_x1) {}
+};
+
 // Use different namespace to classify funcs
 
 namespace Utils {
@@ -37,6 +88,58 @@ namespace Utils {
         return data;
     }
 
+    // Every span becomes one GL_LINES segment from the left edge of x0 to the right edge of x1,
+    // through the pixel centers of row y
+    std::vector<float> spans2lines3d(const std::vector<Span>& spans) {
+        std::vector<float> data;
+        data.resize(6 * spans.size());
+        for (size_t i = 0; i < spans.size(); ++i) {
+            const size_t index = 6 * i;
+            data[index] = spans[i].x0;
+            data[index + 1] = spans[i].y + 0.5f;
+            data[index + 2] = 0.0f;
+            data[index + 3] = spans[i].x1 + 1;
+            data[index + 4] = spans[i].y + 0.5f;
+            data[index + 5] = 0.0f;
+        }
+        return data;
+    }
+
+    // Output iterator for the float generators that keeps x and y of every x, y, z triple as
+    // int16_t, for GL_SHORT vertex buffers. The points must be clipped to the 16-bit range, which
+    // any viewport clip rectangle does.
+    struct ShortPointWriter {
+        int16_t* out;
+        // 0, 1, 2 for the x, y, z float that is written next
+        int component;
+
+        ShortPointWriter(int16_t* _out) : out(_out), component(0) {}
+        ShortPointWriter& operator * () { return *this; }
+        ShortPointWriter& operator ++ () {
+            if (component < 2) {
+                ++out;
+            }
+            component = (component + 1) % 3;
+            return *this;
+        }
+        ShortPointWriter operator ++ (int) {
+            ShortPointWriter old = *this;
+            ++*this;
+            return old;
+        }
+        ShortPointWriter& operator = (const float v) {
+            if (component < 2) {
+                *out = static_cast<int16_t>(v);
+            }
+            return *this;
+        }
+    };
+
+    // Shorts a ShortPointWriter needs for a generator that writes this many floats
+    size_t floats3d2shortsSize(const size_t floats) {
+        return floats / 3 * 2;
+    }
+
     std::vector<float> scrCoor2glCoor(std::vector<float>& _data, const unsigned int scr_width,
                                         const unsigned int scr_height) {
         std::vector<float> data;
@@ -50,206 +153,1217 @@ namespace Utils {
 }
 
 
+// Everything off the clip rectangle is dropped before it is walked, so huge or mostly
+// off-screen primitives only cost what is visible. A clip rectangle is an inclusive bbox in
+// screen coordinates: the viewport, optionally intersected with a scissor rect.
+namespace Clipping {
+    // The pixels of a width x height viewport, same origin as Framebuffer
+    bbox viewport(const int width, const int height) {
+        bbox b;
+        b.xmin = -(width / 2);
+        b.xmax = width - 1 - width / 2;
+        b.ymin = -(height / 2);
+        b.ymax = height - 1 - height / 2;
+        return b;
+    }
+
+    bbox intersect(const bbox& a, const bbox& b) {
+        bbox r;
+        r.xmin = std::max(a.xmin, b.xmin);
+        r.xmax = std::min(a.xmax, b.xmax);
+        r.ymin = std::max(a.ymin, b.ymin);
+        r.ymax = std::min(a.ymax, b.ymax);
+        return r;
+    }
+
+    // Smallest rectangle holding both
+    bbox unite(const bbox& a, const bbox& b) {
+        bbox r;
+        r.xmin = std::min(a.xmin, b.xmin);
+        r.xmax = std::max(a.xmax, b.xmax);
+        r.ymin = std::min(a.ymin, b.ymin);
+        r.ymax = std::max(a.ymax, b.ymax);
+        return r;
+    }
+
+    bbox widen(const bbox& b, const int d) {
+        bbox r;
+        r.xmin = b.xmin - d;
+        r.xmax = b.xmax + d;
+        r.ymin = b.ymin - d;
+        r.ymax = b.ymax + d;
+        return r;
+    }
+
+    // Larger than any target, for the unclipped entry points that share a clipped core
+    bbox unbounded() {
+        bbox b;
+        b.xmin = b.ymin = -(1 << 28);
+        b.xmax = b.ymax = 1 << 28;
+        return b;
+    }
+
+    bool isEmpty(const bbox& b) {
+        return b.xmin > b.xmax || b.ymin > b.ymax;
+    }
+
+    bool contains(const bbox& b, const int x, const int y) {
+        return x >= b.xmin && x <= b.xmax && y >= b.ymin && y <= b.ymax;
+    }
+
+    // Cohen-Sutherland region codes
+    const int INSIDE = 0;
+    const int LEFT = 1;
+    const int RIGHT = 2;
+    const int BOTTOM = 4;
+    const int TOP = 8;
+
+    int outCode(const double x, const double y, const bbox& r) {
+        int code = INSIDE;
+        if (x < r.xmin) code |= LEFT;
+        else if (x > r.xmax) code |= RIGHT;
+        if (y < r.ymin) code |= BOTTOM;
+        else if (y > r.ymax) code |= TOP;
+        return code;
+    }
+
+    // Liang-Barsky: shrink [t0, t1] of p(t) = (x0, y0) + t (dx, dy) to the part inside
+    // [xmin, xmax] x [ymin, ymax], return false if nothing is left
+    bool liangBarsky(const double x0, const double y0, const double dx, const double dy,
+                     const double xmin, const double xmax, const double ymin, const double ymax,
+                     double& t0, double& t1) {
+        const double p[4] = { -dx, dx, -dy, dy };
+        const double q[4] = { x0 - xmin, xmax - x0, y0 - ymin, ymax - y0 };
+        for (int i = 0; i < 4; ++i) {
+            if (p[i] == 0) {
+                if (q[i] < 0) {
+                    return false;
+                }
+                continue;
+            }
+            const double t = q[i] / p[i];
+            if (p[i] < 0) {
+                t0 = std::max(t0, t);
+            }
+            else {
+                t1 = std::min(t1, t);
+            }
+            if (t0 > t1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The major-axis pixels of the line (x0, y0)-(x1, y1) that can land inside r, widened by a
+    // pixel on each side because the rasterized line strays up to half a pixel from the exact one
+    bool majorRange(const double x0, const double y0, const double x1, const double y1, const bbox& r,
+                    const bool isSteep, int32_t& lo, int32_t& hi) {
+        double t0 = 0.0, t1 = 1.0;
+        if (!liangBarsky(x0, y0, x1 - x0, y1 - y0, r.xmin - 1.0, r.xmax + 1.0, r.ymin - 1.0, r.ymax + 1.0, t0, t1)) {
+            return false;
+        }
+        const double m0 = isSteep ? y0 + t0 * (y1 - y0) : x0 + t0 * (x1 - x0);
+        const double m1 = isSteep ? y0 + t1 * (y1 - y0) : x0 + t1 * (x1 - x0);
+        lo = static_cast<int32_t>(std::floor(std::min(m0, m1))) - 1;
+        hi = static_cast<int32_t>(std::ceil(std::max(m0, m1))) + 1;
+        return true;
+    }
+
+    // Within the guard band the float edge functions of whole-pixel triangles are exact
+    // (|A x + B y + C| stays below 2^24), beyond it we fall back to doubles
+    const float GUARD_BAND = 2048.0f;
+
+    bool insideGuardBand(const Point& p0, const Point& p1, const Point& p2) {
+        const Point* ps[3] = { &p0, &p1, &p2 };
+        for (int i = 0; i < 3; ++i) {
+            if (std::abs(ps[i]->x) > GUARD_BAND || std::abs(ps[i]->y) > GUARD_BAND) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
 namespace TriangleRasterization {
-    int min3(const int a, const int b, const int c) {
-        int temp = std::min(a, b);
+    template <typename T>
+    T min3(const T a, const T b, const T c) {
+        T temp = std::min(a, b);
         return std::min(temp, c);
     }
 
-    int max3(const int a, const int b, const int c) {
-        int temp = std::max(a, b);
+    template <typename T>
+    T max3(const T a, const T b, const T c) {
+        T temp = std::max(a, b);
         return std::max(temp, c);
     }
 
+    // Clamp to the Clipping::unbounded() range in double, far-off vertices would overflow the int
+    // cast. NaN goes to the lower end, its edge functions cover nothing anyway.
+    int clampBound(const double v) {
+        const double limit = 1 << 28;
+        return static_cast<int>(v > -limit ? (v < limit ? v : limit) : -limit);
+    }
+
+    // The pixels whose integer coordinates lie inside the triangle's bounds
     void bound3(const Point& p0, const Point& p1, const Point& p2, bbox& b) {
-        b.xmin = ceil(min3(p0.x, p1.x, p2.x));
-        b.xmax = ceil(max3(p0.x, p1.x, p2.x));
-        b.ymin = ceil(min3(p0.y, p1.y, p2.y));
-        b.ymax = ceil(max3(p0.y, p1.y, p2.y));
+        b.xmin = clampBound(std::ceil(min3(p0.x, p1.x, p2.x)));
+        b.xmax = clampBound(std::floor(max3(p0.x, p1.x, p2.x)));
+        b.ymin = clampBound(std::ceil(min3(p0.y, p1.y, p2.y)));
+        b.ymax = clampBound(std::floor(max3(p0.y, p1.y, p2.y)));
     }
 
-    std::vector<float> getABC(const Point& p0, const Point& p1) {
-        // For a line Ax + By + C = 0;
-        // v[0] is A, v[1] is B, v[2] is C
-        std::vector<float> v;
-        v.resize(3);
+    // For a line Ax + By + C = 0, flag is the sign of the halfspace that holds the triangle.
+    // strict edges do not own the pixels that lie exactly on them, see isTopLeft().
+    struct Edge {
+        float a, b, c, flag;
+        bool strict;
+    };
 
-        v[0] = p0.y - p1.y;
-        v[1] = p1.x - p0.x;
-        v[2] = p0.x * p1.y - p1.x * p0.y;
-        return v;
+    // Top-left fill rule. (a, b) is the edge normal pointing into the triangle. A pixel exactly on
+    // an edge belongs to the triangle only if that is a left edge (the inside is towards +x) or a
+    // top edge (horizontal with the inside below). Two triangles sharing an edge see it with
+    // opposite normals, so exactly one of them owns the pixels on it.
+    template <typename T>
+    bool isTopLeft(const T a, const T b) {
+        return a > 0 || (a == 0 && b < 0);
     }
 
-    std::vector<float> edgeEquations(Point& p0, Point& p1, Point& p2) {
-        std::vector<Point> pv;
-        bbox b;
-        bound3(p0, p1, p2, b);
+    // The coefficients of the shared edge of two triangles only differ in sign, whatever the
+    // vertex order: every product is rounded on its own and a - b == -(b - a) in floats.
+    Edge getEdge(const Point& p0, const Point& p1, const Point& opposite) {
+        Edge e;
+        e.a = p0.y - p1.y;
+        e.b = p1.x - p0.x;
+        e.c = p0.x * p1.y - p1.x * p0.y;
+        e.flag = (e.a * opposite.x + e.b * opposite.y + e.c > 0) ? 1.0f : -1.0f;
+        e.strict = !isTopLeft(e.a * e.flag, e.b * e.flag);
+        return e;
+    }
 
-        // Cal 3 lines paras
-        std::vector<std::vector<float>> lines;
-        lines.resize(3);
-        lines[0] = getABC(p0, p1);
-        lines[1] = getABC(p0, p2);
-        lines[2] = getABC(p1, p2);
+    // Test ONLYPOINTS_SIMD_WIDTH pixels along one axis at once, return one bit per covered pixel.
+    // fixed[k] is the edge coefficient times the fixed coordinate, coef[k] the coefficient of the
+    // stepped coordinate, which runs from start. Float addition is commutative, so every pixel is
+    // evaluated exactly as (A * x + B * y) + C whether we step along a row or a column.
+    int coverMask(const Edge edges[3], const float fixed[3], const float coef[3], const int start) {
+#if ONLYPOINTS_SIMD_WIDTH == 8
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 v = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(start)), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+        int mask = 0xff;
+        for (int k = 0; k < 3 && mask; ++k) {
+            __m256 e = _mm256_add_ps(_mm256_set1_ps(fixed[k]), _mm256_mul_ps(_mm256_set1_ps(coef[k]), v));
+            e = _mm256_add_ps(e, _mm256_set1_ps(edges[k].c));
+            e = _mm256_mul_ps(e, _mm256_set1_ps(edges[k].flag));
+            mask &= _mm256_movemask_ps(edges[k].strict ? _mm256_cmp_ps(e, zero, _CMP_GT_OQ) : _mm256_cmp_ps(e, zero, _CMP_GE_OQ));
+        }
+        return mask;
+#elif ONLYPOINTS_SIMD_WIDTH == 4
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 v = _mm_add_ps(_mm_set1_ps(static_cast<float>(start)), _mm_setr_ps(0, 1, 2, 3));
+        int mask = 0xf;
+        for (int k = 0; k < 3 && mask; ++k) {
+            __m128 e = _mm_add_ps(_mm_set1_ps(fixed[k]), _mm_mul_ps(_mm_set1_ps(coef[k]), v));
+            e = _mm_add_ps(e, _mm_set1_ps(edges[k].c));
+            e = _mm_mul_ps(e, _mm_set1_ps(edges[k].flag));
+            mask &= _mm_movemask_ps(edges[k].strict ? _mm_cmpgt_ps(e, zero) : _mm_cmpge_ps(e, zero));
+        }
+        return mask;
+#else
+        const float v = static_cast<float>(start);
+        for (int k = 0; k < 3; ++k) {
+            const float e = (fixed[k] + coef[k] * v + edges[k].c) * edges[k].flag;
+            if (e < 0 || (e == 0 && edges[k].strict)) {
+                return 0;
+            }
+        }
+        return 1;
+#endif
+    }
 
-        auto f = [](const std::vector<float>& line, const Point& p) {
-            return line[0] * p.x + line[1] * p.y + line[2];
-        };
+    // The scans classify blocks of BLOCK_SIZE x BLOCK_SIZE pixels from their corners first.
+    // Blocks fully inside are emitted without testing a pixel, blocks fully outside are skipped,
+    // so only the blocks an edge passes through pay for the per-pixel test.
+    const int BLOCK_SIZE = 8;
+    const int BLOCK_OUTSIDE = 0;
+    const int BLOCK_PARTIAL = 1;
+    const int BLOCK_INSIDE = 2;
 
-        // use flag to determine halfspaces
-        int flag[3];
-        flag[0] = (f(lines[0], p2) > 0) ? 1 : -1;
-        flag[1] = (f(lines[1], p1) > 0) ? 1 : -1;
-        flag[2] = (f(lines[2], p0) > 0) ? 1 : -1;
+    // Bound on the rounding error of the float edge functions anywhere in b. The real error is a
+    // few ulps of |A x| + |B y| + |C|, so a block whose corners clear this margin gets the same
+    // answer from every per-pixel test.
+    void blockMargins(const Edge edges[3], const bbox& b, double margin[3]) {
+        const double mx = std::max(std::abs(double(b.xmin)), std::abs(double(b.xmax)));
+        const double my = std::max(std::abs(double(b.ymin)), std::abs(double(b.ymax)));
+        for (int k = 0; k < 3; ++k) {
+            margin[k] = (std::abs(double(edges[k].a)) * mx + std::abs(double(edges[k].b)) * my +
+                         std::abs(double(edges[k].c))) / (1 << 20);
+        }
+    }
 
-        for (int i = b.xmin; i <= b.xmax; ++i) {
-            for (int j = b.ymin; j <= b.ymax; ++j) {
-                bool inside = true;
-                for (int k = 0; k < lines.size(); ++k) {
-                    if ((lines[k][0] * i + lines[k][1] * j + lines[k][2]) * flag[k] < 0) {
-                        inside = false;
-                        break;
+    // The edge functions are linear, so their extremes over the block are at its corners
+    int classifyBlock(const Edge edges[3], const double margin[3], const int x0, const int y0, const int x1, const int y1) {
+        bool inside = true;
+        for (int k = 0; k < 3; ++k) {
+            const double a = double(edges[k].a) * edges[k].flag;
+            const double b = double(edges[k].b) * edges[k].flag;
+            const double e = a * x0 + b * y0 + double(edges[k].c) * edges[k].flag;
+            const double dx = a * (x1 - x0), dy = b * (y1 - y0);
+            const double lo = e + std::min(dx, 0.0) + std::min(dy, 0.0);
+            const double hi = e + std::max(dx, 0.0) + std::max(dy, 0.0);
+            if (hi < -margin[k]) {
+                return BLOCK_OUTSIDE;
+            }
+            if (lo <= margin[k]) {
+                inside = false;
+            }
+        }
+        return inside ? BLOCK_INSIDE : BLOCK_PARTIAL;
+    }
+
+    // Visit the pixels inside the triangle block by block, column by column inside a block.
+    // A * x is hoisted out of the column and B * y is stepped with the row index, so the
+    // inner loop tests ONLYPOINTS_SIMD_WIDTH rows at once. The sum is still evaluated as
+    // (A * x + B * y) + C, so the coverage is bit-identical to the plain edge equation.
+    template <typename Emit>
+    void scanTriangle(const Point& p0, const Point& p1, const Point& p2, const bbox& b, Emit emit) {
+        Edge edges[3] = { getEdge(p0, p1, p2), getEdge(p0, p2, p1), getEdge(p1, p2, p0) };
+        const float coef[3] = { edges[0].b, edges[1].b, edges[2].b };
+        double margin[3];
+        blockMargins(edges, b, margin);
+
+        for (int x0 = b.xmin; x0 <= b.xmax; x0 += BLOCK_SIZE) {
+            const int x1 = std::min(x0 + BLOCK_SIZE - 1, b.xmax);
+            for (int y0 = b.ymin; y0 <= b.ymax; y0 += BLOCK_SIZE) {
+                const int y1 = std::min(y0 + BLOCK_SIZE - 1, b.ymax);
+                const int coverage = classifyBlock(edges, margin, x0, y0, x1, y1);
+                if (coverage == BLOCK_OUTSIDE) {
+                    continue;
+                }
+
+                for (int i = x0; i <= x1; ++i) {
+                    if (coverage == BLOCK_INSIDE) {
+                        for (int j = y0; j <= y1; ++j) {
+                            emit(i, j);
+                        }
+                        continue;
+                    }
+
+                    const float fi = static_cast<float>(i);
+                    float ax[3];
+                    for (int k = 0; k < 3; ++k) {
+                        ax[k] = edges[k].a * fi;
+                    }
+                    for (int j = y0; j <= y1; j += ONLYPOINTS_SIMD_WIDTH) {
+                        int mask = coverMask(edges, ax, coef, j);
+                        const int rest = y1 - j + 1;
+                        if (rest < ONLYPOINTS_SIMD_WIDTH) {
+                            mask &= (1 << rest) - 1;
+                        }
+                        for (int lane = 0; mask; ++lane, mask >>= 1) {
+                            if (mask & 1) {
+                                emit(i, j + lane);
+                            }
+                        }
                     }
                 }
-                if (inside) {
-                    pv.push_back(Point(i, j));
+            }
+        }
+    }
+
+    // Same coverage as scanTriangle, but call emit(y, x0, x1) once per run of covered pixels
+    // x0..x1 instead of once per pixel. Strips of BLOCK_SIZE rows are walked block by block,
+    // so the runs of one strip come out as they close rather than strictly row by row.
+    template <typename EmitSpan>
+    void scanTriangleSpans(const Point& p0, const Point& p1, const Point& p2, const bbox& b, EmitSpan emit) {
+        Edge edges[3] = { getEdge(p0, p1, p2), getEdge(p0, p2, p1), getEdge(p1, p2, p0) };
+        const float coef[3] = { edges[0].a, edges[1].a, edges[2].a };
+        double margin[3];
+        blockMargins(edges, b, margin);
+
+        for (int y0 = b.ymin; y0 <= b.ymax; y0 += BLOCK_SIZE) {
+            const int y1 = std::min(y0 + BLOCK_SIZE - 1, b.ymax);
+            // Offset from xmin of the open run on each row, -1 means we are not inside a run
+            int runStart[BLOCK_SIZE];
+            std::fill(runStart, runStart + BLOCK_SIZE, -1);
+
+            for (int x0 = b.xmin; x0 <= b.xmax; x0 += BLOCK_SIZE) {
+                const int x1 = std::min(x0 + BLOCK_SIZE - 1, b.xmax);
+                const int coverage = classifyBlock(edges, margin, x0, y0, x1, y1);
+                for (int j = y0; j <= y1; ++j) {
+                    int& run = runStart[j - y0];
+                    if (coverage == BLOCK_INSIDE) {
+                        if (run < 0) {
+                            run = x0 - b.xmin;
+                        }
+                        continue;
+                    }
+                    if (coverage == BLOCK_OUTSIDE) {
+                        if (run >= 0) {
+                            emit(j, b.xmin + run, x0 - 1);
+                            run = -1;
+                        }
+                        continue;
+                    }
+
+                    const float fj = static_cast<float>(j);
+                    float by[3];
+                    for (int k = 0; k < 3; ++k) {
+                        by[k] = edges[k].b * fj;
+                    }
+                    for (int i = x0; i <= x1; i += ONLYPOINTS_SIMD_WIDTH) {
+                        const int mask = coverMask(edges, by, coef, i);
+                        const int rest = std::min(x1 - i + 1, ONLYPOINTS_SIMD_WIDTH);
+                        for (int lane = 0; lane < rest; ++lane) {
+                            const bool inside = (mask >> lane) & 1;
+                            if (inside && run < 0) {
+                                run = i + lane - b.xmin;
+                            }
+                            else if (!inside && run >= 0) {
+                                emit(j, b.xmin + run, i + lane - 1);
+                                run = -1;
+                            }
+                        }
+                    }
+                }
+            }
+            for (int j = y0; j <= y1; ++j) {
+                if (runStart[j - y0] >= 0) {
+                    emit(j, b.xmin + runStart[j - y0], b.xmax);
+                }
+            }
+        }
+    }
+
+    // Same coverage rule as scanTriangleSpans but with double edge functions, for triangles
+    // that reach past the guard band
+    template <typename EmitSpan>
+    void scanTriangleGuarded(const Point& p0, const Point& p1, const Point& p2, const bbox& b, EmitSpan emit) {
+        const double px[3] = { p0.x, p1.x, p2.x };
+        const double py[3] = { p0.y, p1.y, p2.y };
+        // edge k runs between vertices (i, j) and is flagged by the opposite one
+        const int ends[3][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 2, 0 } };
+        double A[3], B[3], C[3];
+        bool strict[3];
+        for (int k = 0; k < 3; ++k) {
+            const int i = ends[k][0], j = ends[k][1], o = ends[k][2];
+            A[k] = py[i] - py[j];
+            B[k] = px[j] - px[i];
+            C[k] = px[i] * py[j] - px[j] * py[i];
+            const double flag = (A[k] * px[o] + B[k] * py[o] + C[k] > 0) ? 1.0 : -1.0;
+            A[k] *= flag;
+            B[k] *= flag;
+            C[k] *= flag;
+            strict[k] = !isTopLeft(A[k], B[k]);
+        }
+
+        for (int j = b.ymin; j <= b.ymax; ++j) {
+            int runStart = 0;
+            bool inRun = false;
+            for (int i = b.xmin; i <= b.xmax; ++i) {
+                bool inside = true;
+                for (int k = 0; k < 3 && inside; ++k) {
+                    const double e = A[k] * i + B[k] * j + C[k];
+                    inside = strict[k] ? e > 0 : e >= 0;
+                }
+                if (inside && !inRun) {
+                    runStart = i;
+                    inRun = true;
                 }
+                else if (!inside && inRun) {
+                    emit(j, runStart, i - 1);
+                    inRun = false;
+                }
+            }
+            if (inRun) {
+                emit(j, runStart, b.xmax);
             }
         }
+    }
 
-        auto data = Utils::points2floats3d(pv);
-        // convert Point Vector to 3D float Vector and return it.
+    // scanTriangleSpans restricted to clip, with guard-band handling
+    template <typename EmitSpan>
+    void scanTriangleSpansClipped(const Point& p0, const Point& p1, const Point& p2, const bbox& clip, EmitSpan emit) {
+        bbox b;
+        bound3(p0, p1, p2, b);
+        b = Clipping::intersect(b, clip);
+        if (Clipping::isEmpty(b)) {
+            return;
+        }
+        if (Clipping::insideGuardBand(p0, p1, p2)) {
+            scanTriangleSpans(p0, p1, p2, b, emit);
+        }
+        else {
+            scanTriangleGuarded(p0, p1, p2, b, emit);
+        }
+    }
+
+    // scanTriangle restricted to clip, with guard-band handling
+    template <typename Emit>
+    void scanTriangleClipped(const Point& p0, const Point& p1, const Point& p2, const bbox& clip, Emit emit) {
+        bbox b;
+        bound3(p0, p1, p2, b);
+        b = Clipping::intersect(b, clip);
+        if (Clipping::isEmpty(b)) {
+            return;
+        }
+        if (Clipping::insideGuardBand(p0, p1, p2)) {
+            scanTriangle(p0, p1, p2, b, emit);
+        }
+        else {
+            scanTriangleGuarded(p0, p1, p2, b, [&emit](const int y, const int x0, const int x1) {
+                for (int x = x0; x <= x1; ++x) {
+                    emit(x, y);
+                }
+            });
+        }
+    }
+
+    // Number of floats edgeEquations writes for this triangle
+    size_t edgeEquationsSize(const Point& p0, const Point& p1, const Point& p2) {
+        bbox b;
+        bound3(p0, p1, p2, b);
+
+        size_t count = 0;
+        scanTriangle(p0, p1, p2, b, [&count](const int, const int) { ++count; });
+        return 3 * count;
+    }
+
+    // Write the covered pixels as 3D floats to out, return the end of the written range
+    template <typename OutIt>
+    OutIt edgeEquations(const Point& p0, const Point& p1, const Point& p2, OutIt out) {
+        bbox b;
+        bound3(p0, p1, p2, b);
+
+        scanTriangle(p0, p1, p2, b, [&out](const int x, const int y) {
+            *out++ = static_cast<float>(x);
+            *out++ = static_cast<float>(y);
+            *out++ = 0.0f;
+        });
+        return out;
+    }
+
+    std::vector<float> edgeEquations(const Point& p0, const Point& p1, const Point& p2) {
+        std::vector<float> data(edgeEquationsSize(p0, p1, p2));
+        edgeEquations(p0, p1, p2, data.data());
         return data;
     }
-}
 
-namespace Bresenham {
-    void flipX(const Point& base, Point& p) {
-        float dy = base.y - p.y;
-        p.y += 2 * dy;
+    // Write the covered pixels as Spans to out, return the end of the written range
+    template <typename OutIt>
+    OutIt edgeEquationsSpans(const Point& p0, const Point& p1, const Point& p2, OutIt out) {
+        bbox b;
+        bound3(p0, p1, p2, b);
+
+        scanTriangleSpans(p0, p1, p2, b, [&out](const int y, const int x0, const int x1) {
+            *out++ = Span(y, x0, x1);
+        });
+        return out;
     }
 
-    void flipXY(Point& p) {
-        float temp = p.x;
-        p.x = p.y;
-        p.y = temp;
+    std::vector<Span> edgeEquationsSpans(const Point& p0, const Point& p1, const Point& p2) {
+        std::vector<Span> spans;
+        edgeEquationsSpans(p0, p1, p2, std::back_inserter(spans));
+        return spans;
     }
 
-    void swap(Point& p1, Point& p2) {
-        float temp;
-        temp = p1.x;
-        p1.x = p2.x;
-        p2.x = temp;
+    // Clipped versions, only the pixels inside clip are produced
+    size_t edgeEquationsSize(const Point& p0, const Point& p1, const Point& p2, const bbox& clip) {
+        size_t count = 0;
+        scanTriangleSpansClipped(p0, p1, p2, clip, [&count](const int, const int x0, const int x1) {
+            count += x1 - x0 + 1;
+        });
+        return 3 * count;
+    }
+
+    template <typename OutIt>
+    OutIt edgeEquations(const Point& p0, const Point& p1, const Point& p2, const bbox& clip, OutIt out) {
+        scanTriangleClipped(p0, p1, p2, clip, [&out](const int x, const int y) {
+            *out++ = static_cast<float>(x);
+            *out++ = static_cast<float>(y);
+            *out++ = 0.0f;
+        });
+        return out;
+    }
 
-        temp = p1.y;
-        p1.y = p2.y;
-        p2.y = temp;
+    std::vector<float> edgeEquations(const Point& p0, const Point& p1, const Point& p2, const bbox& clip) {
+        std::vector<float> data(edgeEquationsSize(p0, p1, p2, clip));
+        edgeEquations(p0, p1, p2, clip, data.data());
+        return data;
     }
 
-    std::vector<float> genLineData(Point v0, Point v1) {
-        // Preparation: Use transformation to  convert all situation to normal situation:
-        // 1. v0.x < v1.x, v0.y < v1.y
-        // 2. delta_x > delta_y
-        if (v0.x > v1.x) {
-            swap(v0, v1);
+    template <typename OutIt>
+    OutIt edgeEquationsSpans(const Point& p0, const Point& p1, const Point& p2, const bbox& clip, OutIt out) {
+        scanTriangleSpansClipped(p0, p1, p2, clip, [&out](const int y, const int x0, const int x1) {
+            *out++ = Span(y, x0, x1);
+        });
+        return out;
+    }
+
+    std::vector<Span> edgeEquationsSpans(const Point& p0, const Point& p1, const Point& p2, const bbox& clip) {
+        std::vector<Span> spans;
+        edgeEquationsSpans(p0, p1, p2, clip, std::back_inserter(spans));
+        return spans;
+    }
+
+    // Filled triangle meshes, vertices holds 3 points per triangle. The top-left rule gives every
+    // pixel on a shared edge to one of the two triangles, so a mesh covers each pixel once.
+    size_t meshDataSize(const std::vector<Point>& vertices) {
+        size_t size = 0;
+        for (size_t i = 0; i + 2 < vertices.size(); i += 3) {
+            size += edgeEquationsSize(vertices[i], vertices[i + 1], vertices[i + 2]);
+        }
+        return size;
+    }
+
+    template <typename OutIt>
+    OutIt genTriangleMeshData(const std::vector<Point>& vertices, OutIt out) {
+        for (size_t i = 0; i + 2 < vertices.size(); i += 3) {
+            out = edgeEquations(vertices[i], vertices[i + 1], vertices[i + 2], out);
         }
+        return out;
+    }
+
+    std::vector<float> genTriangleMeshData(const std::vector<Point>& vertices) {
+        std::vector<float> data(meshDataSize(vertices));
+        genTriangleMeshData(vertices, data.data());
+        return data;
+    }
 
-        bool isflipXY = false;
-        if (std::abs(v0.x - v1.x) < std::abs(v0.y - v1.y)) {
-            flipXY(v0);
-            flipXY(v1);
-            isflipXY = true;
+    size_t meshDataSize(const std::vector<Point>& vertices, const bbox& clip) {
+        size_t size = 0;
+        for (size_t i = 0; i + 2 < vertices.size(); i += 3) {
+            size += edgeEquationsSize(vertices[i], vertices[i + 1], vertices[i + 2], clip);
         }
+        return size;
+    }
+
+    template <typename OutIt>
+    OutIt genTriangleMeshData(const std::vector<Point>& vertices, const bbox& clip, OutIt out) {
+        for (size_t i = 0; i + 2 < vertices.size(); i += 3) {
+            out = edgeEquations(vertices[i], vertices[i + 1], vertices[i + 2], clip, out);
+        }
+        return out;
+    }
+
+    std::vector<float> genTriangleMeshData(const std::vector<Point>& vertices, const bbox& clip) {
+        std::vector<float> data(meshDataSize(vertices, clip));
+        genTriangleMeshData(vertices, clip, data.data());
+        return data;
+    }
+}
+
+// Scanline fill of arbitrary polygons, concave and self-intersecting ones included.
+// Pixel centers are sampled with the same top-left rule as the triangle scans: an edge covers
+// the rows in (ymin, ymax], and on a row the pixels from ceil(x_enter) to ceil(x_leave) - 1
+// are inside, so polygons that share an edge never both cover a pixel on it.
+namespace PolygonRasterization {
+    const int EVEN_ODD = 0;
+    const int NON_ZERO = 1;
+
+    struct PolyEdge {
+        // x on the row y is x0 + (y - y0) * dx / dy, rounded once so that a crossing on a
+        // pixel center comes out exact
+        double x0, y0, dx, dy;
+        // First and last row the edge crosses
+        int yStart, yEnd;
+        // +1 going up, -1 going down
+        int winding;
+    };
+
+    // An active edge and where it crosses the current row
+    struct Crossing {
+        const PolyEdge* edge;
+        double x;
 
-        if (v0.x > v1.x) {
-            swap(v0, v1);
+        bool operator < (const Crossing& rhs) const {
+            return x < rhs.x;
         }
-        bool isflipX = false;
-        if (v0.y > v1.y) {
-            flipX(v0, v1);
-            isflipX = true;
+    };
+
+    // Edge table of the polygon, sorted by first row. Horizontal edges cross no row and are dropped.
+    std::vector<PolyEdge> buildEdgeTable(const std::vector<Point>& vertices) {
+        std::vector<PolyEdge> edges;
+        edges.reserve(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            const Point& a = vertices[i];
+            const Point& b = vertices[(i + 1) % vertices.size()];
+            if (a.y == b.y) {
+                continue;
+            }
+            const Point& lo = a.y < b.y ? a : b;
+            const Point& hi = a.y < b.y ? b : a;
+            PolyEdge e;
+            e.x0 = lo.x;
+            e.y0 = lo.y;
+            e.dx = double(hi.x) - lo.x;
+            e.dy = double(hi.y) - lo.y;
+            e.yStart = static_cast<int>(std::floor(lo.y)) + 1;
+            e.yEnd = static_cast<int>(std::floor(hi.y));
+            e.winding = b.y > a.y ? 1 : -1;
+            if (e.yStart <= e.yEnd) {
+                edges.push_back(e);
+            }
         }
+        std::sort(edges.begin(), edges.end(), [](const PolyEdge& l, const PolyEdge& r) {
+            return l.yStart < r.yStart;
+        });
+        return edges;
+    }
 
-        // Implement the most normal situation
-        int delta_x = v1.x - v0.x;
-        int delta_y = v1.y - v0.y;
+    // Call emit(y, x0, x1) for every run of pixels inside the polygon and inside clip.
+    // vertices is a closed outline, the last vertex connects back to the first.
+    template <typename EmitSpan>
+    void scanPolygon(const std::vector<Point>& vertices, const int rule, const bbox& clip, EmitSpan emit) {
+        const std::vector<PolyEdge> edges = buildEdgeTable(vertices);
+        if (edges.empty()) {
+            return;
+        }
+        int ymin = edges.front().yStart, ymax = edges.front().yEnd;
+        for (const PolyEdge& e : edges) {
+            ymax = std::max(ymax, e.yEnd);
+        }
+        ymin = std::max(ymin, clip.ymin);
+        ymax = std::min(ymax, clip.ymax);
 
-        int p = 2 * delta_y - delta_x;
+        // Active edge list, kept sorted by x across rows
+        std::vector<Crossing> crossings;
+        crossings.reserve(edges.size());
+        size_t next = 0;
+        for (int y = ymin; y <= ymax; ++y) {
+            crossings.erase(std::remove_if(crossings.begin(), crossings.end(), [y](const Crossing& c) {
+                return c.edge->yEnd < y;
+            }), crossings.end());
+            while (next < edges.size() && edges[next].yStart <= y) {
+                if (edges[next].yEnd >= y) {
+                    Crossing c;
+                    c.edge = &edges[next];
+                    crossings.push_back(c);
+                }
+                ++next;
+            }
 
-        std::vector<Point> pv;
-        pv.clear();
-        pv.push_back(v0);
+            for (Crossing& c : crossings) {
+                c.x = c.edge->x0 + (y - c.edge->y0) * c.edge->dx / c.edge->dy;
+            }
+            // The order barely changes from one row to the next, so the insertion sort is close to linear
+            for (size_t i = 1; i < crossings.size(); ++i) {
+                const Crossing c = crossings[i];
+                size_t j = i;
+                for (; j > 0 && c < crossings[j - 1]; --j) {
+                    crossings[j] = crossings[j - 1];
+                }
+                crossings[j] = c;
+            }
 
-        int count = delta_x;
-        while (count--) {
-            Point lastP = pv.back();
+            // Runs that touch are merged before they are emitted
+            int runX0 = 0, runX1 = 0;
+            bool hasRun = false;
+            int winding = 0;
+            for (size_t i = 0; i + 1 < crossings.size(); ++i) {
+                winding += (rule == EVEN_ODD) ? 1 : crossings[i].edge->winding;
+                const bool inside = (rule == EVEN_ODD) ? (winding & 1) != 0 : winding != 0;
+                if (!inside) {
+                    continue;
+                }
+                const int x0 = std::max(static_cast<int>(std::ceil(crossings[i].x)), clip.xmin);
+                const int x1 = std::min(static_cast<int>(std::ceil(crossings[i + 1].x)) - 1, clip.xmax);
+                if (x0 > x1) {
+                    continue;
+                }
+                if (hasRun && x0 <= runX1 + 1) {
+                    runX1 = std::max(runX1, x1);
+                    continue;
+                }
+                if (hasRun) {
+                    emit(y, runX0, runX1);
+                }
+                runX0 = x0;
+                runX1 = x1;
+                hasRun = true;
+            }
+            if (hasRun) {
+                emit(y, runX0, runX1);
+            }
+        }
+    }
+
+    template <typename OutIt>
+    OutIt genPolygonSpans(const std::vector<Point>& vertices, const int rule, const bbox& clip, OutIt out) {
+        scanPolygon(vertices, rule, clip, [&out](const int y, const int x0, const int x1) {
+            *out++ = Span(y, x0, x1);
+        });
+        return out;
+    }
+
+    std::vector<Span> genPolygonSpans(const std::vector<Point>& vertices, const int rule, const bbox& clip) {
+        std::vector<Span> spans;
+        genPolygonSpans(vertices, rule, clip, std::back_inserter(spans));
+        return spans;
+    }
+
+    std::vector<Span> genPolygonSpans(const std::vector<Point>& vertices, const int rule = EVEN_ODD) {
+        return genPolygonSpans(vertices, rule, Clipping::unbounded());
+    }
+
+    // Number of floats genPolygonData writes
+    size_t polygonDataSize(const std::vector<Point>& vertices, const int rule, const bbox& clip) {
+        size_t count = 0;
+        scanPolygon(vertices, rule, clip, [&count](const int, const int x0, const int x1) {
+            count += x1 - x0 + 1;
+        });
+        return 3 * count;
+    }
+
+    // Write the covered pixels as 3D floats to out, return the end of the written range
+    template <typename OutIt>
+    OutIt genPolygonData(const std::vector<Point>& vertices, const int rule, const bbox& clip, OutIt out) {
+        scanPolygon(vertices, rule, clip, [&out](const int y, const int x0, const int x1) {
+            for (int x = x0; x <= x1; ++x) {
+                *out++ = static_cast<float>(x);
+                *out++ = static_cast<float>(y);
+                *out++ = 0.0f;
+            }
+        });
+        return out;
+    }
+
+    std::vector<float> genPolygonData(const std::vector<Point>& vertices, const int rule, const bbox& clip) {
+        std::vector<float> data(polygonDataSize(vertices, rule, clip));
+        genPolygonData(vertices, rule, clip, data.data());
+        return data;
+    }
+
+    std::vector<float> genPolygonData(const std::vector<Point>& vertices, const int rule = EVEN_ODD) {
+        return genPolygonData(vertices, rule, Clipping::unbounded());
+    }
+}
+
+namespace Bresenham {
+    // floor(a / b) for b > 0
+    int64_t floorDiv(const int64_t a, const int64_t b) {
+        return (a >= 0) ? a / b : -((-a + b - 1) / b);
+    }
+
+    // Call plot(x, y) for the pixels of the line whose major coordinate is in [majorMin, majorMax].
+    // The line is walked from the end with the smaller major coordinate, and when the line
+    // passes exactly between two pixels the minor coordinate stays where it was.
+    template <typename Plot>
+    void plotLineRange(IPoint v0, IPoint v1, const int32_t majorMin, const int32_t majorMax, Plot plot) {
+        const bool isSteep = std::abs(v1.x - v0.x) < std::abs(v1.y - v0.y);
+        if (isSteep ? v0.y > v1.y : v0.x > v1.x) {
+            std::swap(v0, v1);
+        }
+
+        // Work on (major, minor) so that one loop handles every octant
+        const int32_t m0 = isSteep ? v0.y : v0.x;
+        const int32_t n0 = isSteep ? v0.x : v0.y;
+        const int32_t delta_m = isSteep ? v1.y - v0.y : v1.x - v0.x;
+        const int32_t delta_n = std::abs(isSteep ? v1.x - v0.x : v1.y - v0.y);
+        const int32_t step = (isSteep ? v1.x >= v0.x : v1.y >= v0.y) ? 1 : -1;
+
+        const int32_t first = std::max(m0, majorMin);
+        const int32_t last = std::min(m0 + delta_m, majorMax);
+        if (first > last) {
+            return;
+        }
+
+        // Jump straight to step k: the minor offset is ceil((2 dn k - dm) / (2 dm)) and
+        // p = 2 dn (k + 1) - dm (2 offset + 1)
+        const int64_t k = first - m0;
+        int64_t offset = 0;
+        if (delta_m > 0) {
+            offset = -floorDiv(-(2 * int64_t(delta_n) * k - delta_m), 2 * int64_t(delta_m));
+        }
+        int32_t p = static_cast<int32_t>(2 * int64_t(delta_n) * (k + 1) - int64_t(delta_m) * (2 * offset + 1));
+        int32_t n = static_cast<int32_t>(n0 + step * offset);
+        for (int32_t m = first; m <= last; ++m) {
+            if (isSteep) {
+                plot(n, m);
+            }
+            else {
+                plot(m, n);
+            }
             if (p <= 0) {
-                pv.push_back(Point(lastP.x + 1, lastP.y));
-                p += 2 * delta_y;
+                p += 2 * delta_n;
             }
             else {
-                pv.push_back(Point(lastP.x + 1, lastP.y + 1));
-                p = p + 2 * delta_y - 2 * delta_x;
+                n += step;
+                p += 2 * delta_n - 2 * delta_m;
             }
         }
+    }
+
+    // Call plot(x, y) for every pixel of the line, without any allocation
+    template <typename Plot>
+    void plotLine(const IPoint& v0, const IPoint& v1, Plot plot) {
+        plotLineRange(v0, v1, INT32_MIN, INT32_MAX, plot);
+    }
 
-        // Reverse the transformation in the preparation
-        if (isflipX) {
-            Point base = pv.front();
-            for (auto& p : pv) {
-                flipX(base, p);
+    // Only the pixels inside clip. Lines fully on one side of it are rejected by their
+    // Cohen-Sutherland codes, and crossing lines only walk the Liang-Barsky visible range.
+    template <typename Plot>
+    void plotLine(const IPoint& v0, const IPoint& v1, const bbox& clip, Plot plot) {
+        const int c0 = Clipping::outCode(v0.x, v0.y, clip);
+        const int c1 = Clipping::outCode(v1.x, v1.y, clip);
+        if (c0 & c1) {
+            return;
+        }
+        if ((c0 | c1) == Clipping::INSIDE) {
+            plotLine(v0, v1, plot);
+            return;
+        }
+        const bool isSteep = std::abs(v1.x - v0.x) < std::abs(v1.y - v0.y);
+        int32_t lo, hi;
+        if (!Clipping::majorRange(v0.x, v0.y, v1.x, v1.y, clip, isSteep, lo, hi)) {
+            return;
+        }
+        plotLineRange(v0, v1, lo, hi, [&clip, &plot](const int x, const int y) {
+            if (Clipping::contains(clip, x, y)) {
+                plot(x, y);
             }
+        });
+    }
+
+    // The pixel range [first, last] of a sub-pixel line along its major axis.
+    // Pixel m owns the major interval (m - 0.5, m + 0.5].
+    void subpixelMajorRange(const int32_t from, const int32_t to, int32_t& first, int32_t& last) {
+        first = static_cast<int32_t>(-floorDiv(-(int64_t(from) - FIXED_ONE / 2), FIXED_ONE));
+        last = static_cast<int32_t>(-floorDiv(-(int64_t(to) - FIXED_ONE / 2), FIXED_ONE));
+    }
+
+    // Same as plotLine, but v0 and v1 are in 28.4 fixed point. Every pixel center on the major
+    // axis between the endpoints gets the pixel nearest to the exact line, with the same tie rule
+    // as plotLine, so whole-pixel endpoints give exactly the plotLine pixels.
+    template <typename Plot>
+    void plotLineSubpixelRange(IPoint v0, IPoint v1, const int32_t majorMin, const int32_t majorMax, Plot plot) {
+        const bool isSteep = std::abs(v1.x - v0.x) < std::abs(v1.y - v0.y);
+        if (isSteep ? v0.y > v1.y : v0.x > v1.x) {
+            std::swap(v0, v1);
         }
 
-        if (isflipXY) {
-            std::for_each(pv.begin(), pv.end(), flipXY);
+        const int64_t M0 = isSteep ? v0.y : v0.x;
+        const int64_t M1 = isSteep ? v1.y : v1.x;
+        int64_t N0 = isSteep ? v0.x : v0.y;
+        int64_t N1 = isSteep ? v1.x : v1.y;
+        // Mirror a falling line so the minor coordinate always grows, ties then round back
+        // toward the start in both cases
+        const int32_t step = (N1 >= N0) ? 1 : -1;
+        if (step < 0) {
+            N0 = -N0;
+            N1 = -N1;
         }
-        
-        auto data = Utils::points2floats3d(pv);
-        // convert Point Vector to 3D float Vector and return it.
-        return data;
+        const int64_t dM = M1 - M0;
+        const int64_t dN = N1 - N0;
+
+        int32_t first, last;
+        subpixelMajorRange(static_cast<int32_t>(M0), static_cast<int32_t>(M1), first, last);
+        first = std::max(first, majorMin);
+        last = std::min(last, majorMax);
+        if (first > last) {
+            return;
+        }
+
+        auto emit = [&](const int32_t m, const int64_t n) {
+            const int32_t minor = static_cast<int32_t>(step * n);
+            if (isSteep) {
+                plot(minor, m);
+            }
+            else {
+                plot(m, minor);
+            }
+        };
+
+        if (dM == 0) {
+            emit(first, -floorDiv(-(N0 - FIXED_ONE / 2), FIXED_ONE));
+            return;
+        }
+
+        // The exact minor coordinate at the center of pixel m is N0 + (16 m - M0) * dN / dM,
+        // we want n = ceil((that - 8) / 16) = ceil(num / (16 dM)) and keep the remainder
+        // r = 16 dM n - num in [0, 16 dM) as the error term.
+        const int64_t den = FIXED_ONE * dM;
+        int64_t num = (N0 - FIXED_ONE / 2) * dM + (int64_t(FIXED_ONE) * first - M0) * dN;
+        int64_t n = -floorDiv(-num, den);
+        int64_t r = den * n - num;
+        const int64_t rstep = FIXED_ONE * dN;
+        for (int32_t m = first; m <= last; ++m) {
+            emit(m, n);
+            r -= rstep;
+            if (r < 0) {
+                ++n;
+                r += den;
+            }
+        }
+    }
+
+    template <typename Plot>
+    void plotLineSubpixel(const IPoint& v0, const IPoint& v1, Plot plot) {
+        plotLineSubpixelRange(v0, v1, INT32_MIN, INT32_MAX, plot);
+    }
+
+    // The endpoints in 28.4 fixed point. Past FIXED_LIMIT toFixed would clamp them and bend the
+    // line, so such a line is first cut in double to clip widened by a pixel (the end pixels can
+    // be half a pixel past the exact endpoints). Returns false if nothing is left.
+    bool toFixedClipped(const Point& v0, const Point& v1, const bbox& clip, IPoint& f0, IPoint& f1) {
+        double x0 = v0.x, y0 = v0.y, x1 = v1.x, y1 = v1.y;
+        const double limit = FIXED_LIMIT;
+        if (std::abs(x0) <= limit && std::abs(y0) <= limit && std::abs(x1) <= limit && std::abs(y1) <= limit) {
+            f0 = toFixed(v0);
+            f1 = toFixed(v1);
+            return true;
+        }
+        if (!std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1)) {
+            return false;
+        }
+        bbox representable;
+        representable.xmin = representable.ymin = -FIXED_LIMIT;
+        representable.xmax = representable.ymax = FIXED_LIMIT;
+        const bbox r = Clipping::intersect(Clipping::widen(clip, 1), representable);
+        double t0 = 0.0, t1 = 1.0;
+        const double dx = x1 - x0, dy = y1 - y0;
+        if (Clipping::isEmpty(r) || !Clipping::liangBarsky(x0, y0, dx, dy, r.xmin, r.xmax, r.ymin, r.ymax, t0, t1)) {
+            return false;
+        }
+        x1 = x0 + t1 * dx;
+        y1 = y0 + t1 * dy;
+        x0 += t0 * dx;
+        y0 += t0 * dy;
+        f0 = IPoint(toFixed(x0), toFixed(y0));
+        f1 = IPoint(toFixed(x1), toFixed(y1));
+        return true;
     }
 
-    std::vector<float> genTriangleData(Point& p0, Point& p1, Point& p2, bool isfill = false) {
-        auto data = genLineData(p0, p1);
-        auto line2data = genLineData(p0, p2);
-        auto line3data = genLineData(p1, p2);
+    // Float endpoints are rounded to 1/16 pixel once, the rest is integer math
+    template <typename Plot>
+    void plotLine(const Point& v0, const Point& v1, Plot plot) {
+        IPoint f0, f1;
+        if (toFixedClipped(v0, v1, Clipping::unbounded(), f0, f1)) {
+            plotLineSubpixel(f0, f1, plot);
+        }
+    }
 
-        data.insert(data.end(), line2data.begin(), line2data.end());
-        data.insert(data.end(), line3data.begin(), line3data.end());
+    // Only the pixels inside clip, see plotLine(IPoint, IPoint, clip, plot)
+    template <typename Plot>
+    void plotLine(const Point& v0, const Point& v1, const bbox& clip, Plot plot) {
+        IPoint f0, f1;
+        if (!toFixedClipped(v0, v1, clip, f0, f1)) {
+            return;
+        }
+        const double x0 = double(f0.x) / FIXED_ONE, y0 = double(f0.y) / FIXED_ONE;
+        const double x1 = double(f1.x) / FIXED_ONE, y1 = double(f1.y) / FIXED_ONE;
+        // The end pixels can be up to half a pixel past the exact endpoints
+        const bbox wide = Clipping::widen(clip, 1);
+        if (Clipping::outCode(x0, y0, wide) & Clipping::outCode(x1, y1, wide)) {
+            return;
+        }
+        // and for the same reason a line whose ends are a pixel inside clip needs no test at all
+        const bbox narrow = Clipping::widen(clip, -1);
+        if ((Clipping::outCode(x0, y0, narrow) | Clipping::outCode(x1, y1, narrow)) == Clipping::INSIDE) {
+            plotLineSubpixel(f0, f1, plot);
+            return;
+        }
+        const bool isSteep = std::abs(f1.x - f0.x) < std::abs(f1.y - f0.y);
+        int32_t lo, hi;
+        if (!Clipping::majorRange(x0, y0, x1, y1, clip, isSteep, lo, hi)) {
+            return;
+        }
+        plotLineSubpixelRange(f0, f1, lo, hi, [&clip, &plot](const int x, const int y) {
+            if (Clipping::contains(clip, x, y)) {
+                plot(x, y);
+            }
+        });
+    }
 
-        if (isfill) {
-            // bonus
-            auto insideData = TriangleRasterization::edgeEquations(p0, p1, p2);
-            data.insert(data.end(), insideData.begin(), insideData.end());
+    // Number of floats genLineData writes for this line
+    size_t lineDataSize(const Point& v0, const Point& v1) {
+        IPoint f0, f1;
+        if (!toFixedClipped(v0, v1, Clipping::unbounded(), f0, f1)) {
+            return 0;
         }
+        const bool isSteep = std::abs(f1.x - f0.x) < std::abs(f1.y - f0.y);
+        int32_t from = isSteep ? f0.y : f0.x;
+        int32_t to = isSteep ? f1.y : f1.x;
+        if (from > to) {
+            std::swap(from, to);
+        }
+        int32_t first, last;
+        subpixelMajorRange(from, to, first, last);
+        return 3 * size_t(last - first + 1);
+    }
+
+    // Write the line as 3D floats to out, return the end of the written range
+    template <typename OutIt>
+    OutIt genLineData(const Point& v0, const Point& v1, OutIt out) {
+        plotLine(v0, v1, [&out](const int x, const int y) {
+            *out++ = static_cast<float>(x);
+            *out++ = static_cast<float>(y);
+            *out++ = 0.0f;
+        });
+        return out;
+    }
+
+    std::vector<float> genLineData(const Point& v0, const Point& v1) {
+        std::vector<float> data(lineDataSize(v0, v1));
+        genLineData(v0, v1, data.data());
         return data;
     }
 
-    void addCirclePlot(std::vector<Point>& pv, const Point& origin, const float x, const float y) {
-        std::vector<Point> eightPoints = {
-            Point(x + origin.x, y + origin.y), Point(y + origin.x, x + origin.y),
-            Point(y + origin.x, -x + origin.y), Point(x + origin.x, -y + origin.y),
-            Point(-x + origin.x, -y + origin.y), Point(-y + origin.x, -x + origin.y),
-            Point(-y + origin.x, x + origin.y), Point(-x + origin.x, y + origin.y)
+    // Clipped versions, only the pixels inside clip are produced
+    size_t lineDataSize(const Point& v0, const Point& v1, const bbox& clip) {
+        size_t count = 0;
+        plotLine(v0, v1, clip, [&count](const int, const int) { ++count; });
+        return 3 * count;
+    }
+
+    template <typename OutIt>
+    OutIt genLineData(const Point& v0, const Point& v1, const bbox& clip, OutIt out) {
+        plotLine(v0, v1, clip, [&out](const int x, const int y) {
+            *out++ = static_cast<float>(x);
+            *out++ = static_cast<float>(y);
+            *out++ = 0.0f;
+        });
+        return out;
+    }
+
+    std::vector<float> genLineData(const Point& v0, const Point& v1, const bbox& clip) {
+        std::vector<float> data(lineDataSize(v0, v1, clip));
+        genLineData(v0, v1, clip, data.data());
+        return data;
+    }
+
+    // Rows of a triangle plotTriangle() keeps the line runs of at once
+    const int TRIANGLE_BAND = 64;
+
+    // Call plot(x, y) once for every pixel of the triangle outline inside clip, and with isfill
+    // once for every interior pixel too. The vertices, pixels where two edges meet, and interior
+    // pixels under the outline are produced only once.
+    // The pixels of a Bresenham line on one row are always a single run, so the outline of a
+    // triangle is fully described by the x range each of its three lines covers on each row.
+    // The triangle is produced in bands of TRIANGLE_BAND rows with the ranges of one band on
+    // the stack: every line is clipped to the band, which jumps straight to its first pixel
+    // there, and a pixel is skipped when an earlier line covers it. No allocation.
+    template <typename Plot>
+    void plotTriangle(const Point& p0, const Point& p1, const Point& p2, const bool isfill, const bbox& clip, Plot plot) {
+        // Line pixels round to the nearest row, so they stay within one row of the vertices
+        const int ymin = static_cast<int>(std::max(std::floor(TriangleRasterization::min3(p0.y, p1.y, p2.y)) - 1.0, double(clip.ymin)));
+        const int ymax = static_cast<int>(std::min(std::ceil(TriangleRasterization::max3(p0.y, p1.y, p2.y)) + 1.0, double(clip.ymax)));
+        if (ymin > ymax || clip.xmin > clip.xmax) {
+            return;
+        }
+
+        const Point ends[3][2] = { { p0, p1 }, { p0, p2 }, { p1, p2 } };
+        // lo and hi of line k on row band.ymin + i are range[i][2 k] and range[i][2 k + 1],
+        // the row is empty while lo > hi
+        int32_t range[TRIANGLE_BAND][6];
+        bbox band = clip;
+        // Whether one of the first n lines has a pixel at (x, y)
+        auto covers = [&range, &band](const int n, const int x, const int y) {
+            const int32_t* r = range[y - band.ymin];
+            for (int k = 0; k < n; ++k) {
+                if (x >= r[2 * k] && x <= r[2 * k + 1]) {
+                    return true;
+                }
+            }
+            return false;
         };
-        pv.insert(pv.end(), eightPoints.begin(), eightPoints.end());
+
+        for (band.ymin = ymin; band.ymin <= ymax; band.ymin += TRIANGLE_BAND) {
+            band.ymax = std::min(band.ymin + (TRIANGLE_BAND - 1), ymax);
+            for (int i = 0; i <= band.ymax - band.ymin; ++i) {
+                for (int k = 0; k < 6; k += 2) {
+                    range[i][k] = INT32_MAX;
+                    range[i][k + 1] = INT32_MIN;
+                }
+            }
+            for (int k = 0; k < 3; ++k) {
+                plotLine(ends[k][0], ends[k][1], band, [&](const int x, const int y) {
+                    if (!covers(k, x, y)) {
+                        plot(x, y);
+                    }
+                    int32_t* r = &range[y - band.ymin][2 * k];
+                    r[0] = std::min(r[0], x);
+                    r[1] = std::max(r[1], x);
+                });
+            }
+
+            if (isfill) {
+                // bonus
+                TriangleRasterization::scanTriangleSpansClipped(p0, p1, p2, band,
+                    [&covers, &plot](const int y, const int x0, const int x1) {
+                        for (int x = x0; x <= x1; ++x) {
+                            if (!covers(3, x, y)) {
+                                plot(x, y);
+                            }
+                        }
+                    });
+            }
+        }
+    }
+
+    // Number of floats genTriangleData writes for this triangle
+    size_t triangleDataSize(const Point& p0, const Point& p1, const Point& p2, bool isfill, const bbox& clip) {
+        size_t count = 0;
+        plotTriangle(p0, p1, p2, isfill, clip, [&count](const int, const int) { ++count; });
+        return 3 * count;
+    }
+
+    // Write the triangle as 3D floats to out, return the end of the written range.
+    // Only the pixels inside clip are produced, each of them once.
+    template <typename OutIt>
+    OutIt genTriangleData(const Point& p0, const Point& p1, const Point& p2, bool isfill, const bbox& clip, OutIt out) {
+        plotTriangle(p0, p1, p2, isfill, clip, [&out](const int x, const int y) {
+            *out++ = static_cast<float>(x);
+            *out++ = static_cast<float>(y);
+            *out++ = 0.0f;
+        });
+        return out;
+    }
+
+    std::vector<float> genTriangleData(const Point& p0, const Point& p1, const Point& p2, bool isfill, const bbox& clip) {
+        std::vector<float> data(triangleDataSize(p0, p1, p2, isfill, clip));
+        genTriangleData(p0, p1, p2, isfill, clip, data.data());
+        return data;
+    }
+
+    // Unclipped versions
+    size_t triangleDataSize(const Point& p0, const Point& p1, const Point& p2, bool isfill = false) {
+        return triangleDataSize(p0, p1, p2, isfill, Clipping::unbounded());
+    }
+
+    template <typename OutIt>
+    OutIt genTriangleData(const Point& p0, const Point& p1, const Point& p2, bool isfill, OutIt out) {
+        return genTriangleData(p0, p1, p2, isfill, Clipping::unbounded(), out);
+    }
+
+    std::vector<float> genTriangleData(const Point& p0, const Point& p1, const Point& p2, bool isfill = false) {
+        return genTriangleData(p0, p1, p2, isfill, Clipping::unbounded());
     }
 
-    std::vector<float> genCircleData(Point& origin, const int R) {
+    template <typename Plot>
+    void addCirclePlot(Plot& plot, const IPoint& origin, const int32_t x, const int32_t y) {
+        plot(x + origin.x, y + origin.y);
+        plot(y + origin.x, x + origin.y);
+        plot(y + origin.x, -x + origin.y);
+        plot(x + origin.x, -y + origin.y);
+        plot(-x + origin.x, -y + origin.y);
+        plot(-y + origin.x, -x + origin.y);
+        plot(-y + origin.x, x + origin.y);
+        plot(-x + origin.x, y + origin.y);
+    }
+
+    // Call plot(x, y) for every pixel of the circle, without any allocation
+    template <typename Plot>
+    void plotCircle(const IPoint& origin, const int R, Plot plot) {
         if (R < 2) {
-            return std::vector<float>();
+            return;
         }
 
-        std::vector<Point> pv;
-        pv.clear();
-
-        int x, y, d;
+        int32_t x, y, d;
 
         x = 0;
         y = R;
         d = 3 - 2 * R;
-        addCirclePlot(pv, origin, x, y);
+        addCirclePlot(plot, origin, x, y);
         while (x < y) {
             if (d < 0) {
                 d = d + 4 * x + 6;
@@ -259,10 +1373,582 @@ namespace Bresenham {
                 --y;
             }
             ++x;
-            addCirclePlot(pv, origin, x, y);
+            addCirclePlot(plot, origin, x, y);
+        }
+    }
+
+    // The origin is rounded to the nearest pixel
+    template <typename Plot>
+    void plotCircle(const Point& origin, const int R, Plot plot) {
+        plotCircle(toPixel(origin), R, plot);
+    }
+
+    // Only the pixels inside clip: circles off the clip rectangle are rejected by their
+    // bounding square, and circles inside it skip the per-pixel test
+    template <typename Plot>
+    void plotCircle(const Point& origin, const int R, const bbox& clip, Plot plot) {
+        const IPoint o = toPixel(origin);
+        bbox square;
+        square.xmin = o.x - R;
+        square.xmax = o.x + R;
+        square.ymin = o.y - R;
+        square.ymax = o.y + R;
+        const bbox visible = Clipping::intersect(square, clip);
+        if (Clipping::isEmpty(visible)) {
+            return;
+        }
+        if (visible.xmin == square.xmin && visible.xmax == square.xmax &&
+            visible.ymin == square.ymin && visible.ymax == square.ymax) {
+            plotCircle(o, R, plot);
+            return;
         }
-        auto data = Utils::points2floats3d(pv);
+        plotCircle(o, R, [&clip, &plot](const int x, const int y) {
+            if (Clipping::contains(clip, x, y)) {
+                plot(x, y);
+            }
+        });
+    }
+
+    // Number of floats genCircleData writes for this radius
+    size_t circleDataSize(const int R) {
+        size_t count = 0;
+        plotCircle(IPoint(0, 0), R, [&count](const int, const int) { ++count; });
+        return 3 * count;
+    }
+
+    // Write the circle as 3D floats to out, return the end of the written range
+    template <typename OutIt>
+    OutIt genCircleData(const Point& origin, const int R, OutIt out) {
+        plotCircle(origin, R, [&out](const int x, const int y) {
+            *out++ = static_cast<float>(x);
+            *out++ = static_cast<float>(y);
+            *out++ = 0.0f;
+        });
+        return out;
+    }
+
+    std::vector<float> genCircleData(const Point& origin, const int R) {
+        std::vector<float> data(circleDataSize(R));
+        genCircleData(origin, R, data.data());
         return data;
     }
-}
 
+    // Clipped versions, only the pixels inside clip are produced
+    size_t circleDataSize(const Point& origin, const int R, const bbox& clip) {
+        size_t count = 0;
+        plotCircle(origin, R, clip, [&count](const int, const int) { ++count; });
+        return 3 * count;
+    }
+
+    template <typename OutIt>
+    OutIt genCircleData(const Point& origin, const int R, const bbox& clip, OutIt out) {
+        plotCircle(origin, R, clip, [&out](const int x, const int y) {
+            *out++ = static_cast<float>(x);
+            *out++ = static_cast<float>(y);
+            *out++ = 0.0f;
+        });
+        return out;
+    }
+
+    std::vector<float> genCircleData(const Point& origin, const int R, const bbox& clip) {
+        std::vector<float> data(circleDataSize(origin, R, clip));
+        genCircleData(origin, R, clip, data.data());
+        return data;
+    }
+
+    // Filled circle as one span per row, bottom to top. The span of a row reaches the outermost
+    // outline pixel of genCircleData on that row.
+    // Only the part inside clip is produced: the half widths are kept for the visible rows only
+    // and the walk along the outline stops once it is past them, so a huge circle mostly off
+    // the clip rectangle costs what its visible rows cost.
+    template <typename OutIt>
+    OutIt genFilledCircleSpans(const Point& origin, const int R, const bbox& clip, OutIt out) {
+        if (R < 2) {
+            return out;
+        }
+        const IPoint o = toPixel(origin);
+        const int ymin = std::max(o.y - R, clip.ymin);
+        const int ymax = std::min(o.y + R, clip.ymax);
+        if (ymin > ymax || o.x - R > clip.xmax || o.x + R < clip.xmin) {
+            return out;
+        }
+
+        // Half widths of the rows lo <= |dy| <= hi above and below the center
+        const int lo = (ymin <= o.y && o.y <= ymax) ? 0 : std::min(std::abs(ymin - o.y), std::abs(ymax - o.y));
+        const int hi = std::max(std::abs(ymin - o.y), std::abs(ymax - o.y));
+        std::vector<int> halfWidth(hi - lo + 1, 0);
+        auto widen = [&halfWidth, lo, hi](const int dy, const int hw) {
+            if (dy >= lo && dy <= hi) {
+                halfWidth[dy - lo] = std::max(halfWidth[dy - lo], hw);
+            }
+        };
+
+        // The midpoint walk of plotCircle over one octant, (x, y) and (y, x) give rows y and x
+        int32_t x = 0, y = R, d = 3 - 2 * R;
+        widen(y, x);
+        widen(x, y);
+        while (x < y && (y >= lo || x <= hi)) {
+            if (d < 0) {
+                d = d + 4 * x + 6;
+            }
+            else {
+                d = d + 4 * (x - y) + 10;
+                --y;
+            }
+            ++x;
+            widen(y, x);
+            widen(x, y);
+        }
+
+        for (int row = ymin; row <= ymax; ++row) {
+            const int hw = halfWidth[std::abs(row - o.y) - lo];
+            const int x0 = std::max(o.x - hw, clip.xmin);
+            const int x1 = std::min(o.x + hw, clip.xmax);
+            if (x0 <= x1) {
+                *out++ = Span(row, x0, x1);
+            }
+        }
+        return out;
+    }
+
+    std::vector<Span> genFilledCircleSpans(const Point& origin, const int R, const bbox& clip) {
+        std::vector<Span> spans;
+        if (R >= 2) {
+            const int rows = std::min(toPixel(origin).y + R, clip.ymax) - std::max(toPixel(origin).y - R, clip.ymin) + 1;
+            spans.reserve(std::max(rows, 0));
+        }
+        genFilledCircleSpans(origin, R, clip, std::back_inserter(spans));
+        return spans;
+    }
+
+    // Unclipped versions
+    template <typename OutIt>
+    OutIt genFilledCircleSpans(const Point& origin, const int R, OutIt out) {
+        return genFilledCircleSpans(origin, R, Clipping::unbounded(), out);
+    }
+
+    std::vector<Span> genFilledCircleSpans(const Point& origin, const int R) {
+        return genFilledCircleSpans(origin, R, Clipping::unbounded());
+    }
+
+    // Arcs run counterclockwise from angle start to angle end, in radians from +x. Angles are
+    // those of the pixels around the center, for an ellipse too (not the parametric angle).
+    // An arc of 2 pi or more is the whole curve, start == end is empty.
+    // The curves are symmetric, so every octant (circle) or quadrant (ellipse) is classified
+    // once: fully on the arc, fully off it, or holding an arc end. Only pixels of the octants
+    // holding an end are tested, with cross products against the end directions.
+    const double TWO_PI = 6.283185307179586;
+    const int ARC_OUTSIDE = 0;
+    const int ARC_INSIDE = 1;
+    const int ARC_PARTIAL = 2;
+
+    struct ArcRange {
+        double sx, sy, ex, ey;
+        bool empty, full, large;
+        // By sector, [k * 2 pi / sectors, (k + 1) * 2 pi / sectors]
+        int sector[8];
+
+        // (x, y) is relative to the center
+        bool contains(const double x, const double y) const {
+            if (full) {
+                return true;
+            }
+            if (empty) {
+                return false;
+            }
+            const bool afterStart = sx * y - sy * x >= 0;
+            const bool beforeEnd = ex * y - ey * x <= 0;
+            return large ? (afterStart || beforeEnd) : (afterStart && beforeEnd);
+        }
+
+        bool accepts(const int k, const int32_t x, const int32_t y) const {
+            return sector[k] == ARC_INSIDE || (sector[k] == ARC_PARTIAL && contains(x, y));
+        }
+
+        // Apply the sector state to one symmetric image of a pixel
+        template <typename Plot>
+        void apply(Plot& plot, const int k, const IPoint& origin, const int32_t x, const int32_t y) const {
+            if (accepts(k, x, y)) {
+                plot(x + origin.x, y + origin.y);
+            }
+        }
+
+        // A pixel on the bound of sectors k0 and k1, plotted once if either of them holds it
+        template <typename Plot>
+        void applyShared(Plot& plot, const int k0, const int k1, const IPoint& origin, const int32_t x, const int32_t y) const {
+            if (accepts(k0, x, y) || accepts(k1, x, y)) {
+                plot(x + origin.x, y + origin.y);
+            }
+        }
+    };
+
+    ArcRange arcRange(const double start, const double end, const int sectors) {
+        ArcRange arc;
+        const double sweep = end - start;
+        arc.full = sweep >= TWO_PI;
+        arc.empty = sweep == 0.0 || sweep != sweep;
+        const double s = start - TWO_PI * std::floor(start / TWO_PI);
+        const double span = sweep - TWO_PI * std::floor(sweep / TWO_PI);
+        const double e = s + span;
+        arc.large = span > TWO_PI / 2;
+        arc.sx = std::cos(start);
+        arc.sy = std::sin(start);
+        arc.ex = std::cos(end);
+        arc.ey = std::sin(end);
+
+        // Angle t (in [0, 2 pi)) is on the arc if it is at most span past s
+        auto onArc = [s, span](const double t) {
+            return t - s - TWO_PI * std::floor((t - s) / TWO_PI) <= span;
+        };
+        // Sector bounds are widened a little so that rounding never misses an end on a bound
+        const double eps = 1e-9;
+        const double e2 = e - TWO_PI * std::floor(e / TWO_PI);
+        for (int k = 0; k < sectors; ++k) {
+            const double a0 = k * TWO_PI / sectors - eps;
+            const double a1 = (k + 1) * TWO_PI / sectors + eps;
+            if (arc.full) {
+                arc.sector[k] = ARC_INSIDE;
+            }
+            else if (arc.empty) {
+                arc.sector[k] = ARC_OUTSIDE;
+            }
+            else if ((s >= a0 && s <= a1) || (e2 >= a0 && e2 <= a1) || (k == 0 && (s > TWO_PI - eps || e2 > TWO_PI - eps))) {
+                arc.sector[k] = ARC_PARTIAL;
+            }
+            else {
+                arc.sector[k] = onArc((k + 0.5) * TWO_PI / sectors) ? ARC_INSIDE : ARC_OUTSIDE;
+            }
+        }
+        return arc;
+    }
+
+    // addCirclePlot restricted to the arc, (x, y) is in octant 1 with 0 <= x <= y. Images that
+    // coincide on an axis (x == 0) or a diagonal (x == y) are plotted once.
+    template <typename Plot>
+    void addArcPlot(Plot& plot, const ArcRange& arc, const IPoint& origin, const int32_t x, const int32_t y) {
+        if (x > y) {
+            // The last step of plotCircle can cross the diagonal, (y, x) is then the previous pixel
+            return;
+        }
+        if (x == 0) {
+            arc.applyShared(plot, 7, 0, origin, y, 0);
+            arc.applyShared(plot, 1, 2, origin, 0, y);
+            arc.applyShared(plot, 3, 4, origin, -y, 0);
+            arc.applyShared(plot, 5, 6, origin, 0, -y);
+            return;
+        }
+        if (x == y) {
+            arc.applyShared(plot, 0, 1, origin, x, x);
+            arc.applyShared(plot, 2, 3, origin, -x, x);
+            arc.applyShared(plot, 4, 5, origin, -x, -x);
+            arc.applyShared(plot, 6, 7, origin, x, -x);
+            return;
+        }
+        arc.apply(plot, 1, origin, x, y);
+        arc.apply(plot, 0, origin, y, x);
+        arc.apply(plot, 7, origin, y, -x);
+        arc.apply(plot, 6, origin, x, -y);
+        arc.apply(plot, 5, origin, -x, -y);
+        arc.apply(plot, 4, origin, -y, -x);
+        arc.apply(plot, 3, origin, -y, x);
+        arc.apply(plot, 2, origin, -x, y);
+    }
+
+    // The pixels of plotCircle that lie on the arc
+    template <typename Plot>
+    void plotArc(const IPoint& origin, const int R, const double start, const double end, Plot plot) {
+        const ArcRange arc = arcRange(start, end, 8);
+        if (R < 2 || arc.empty) {
+            return;
+        }
+
+        int32_t x = 0, y = R, d = 3 - 2 * R;
+        addArcPlot(plot, arc, origin, x, y);
+        while (x < y) {
+            if (d < 0) {
+                d = d + 4 * x + 6;
+            }
+            else {
+                d = d + 4 * (x - y) + 10;
+                --y;
+            }
+            ++x;
+            addArcPlot(plot, arc, origin, x, y);
+        }
+    }
+
+    // One pixel of the first quadrant and its mirror images, pixels on an axis are plotted once
+    template <typename Plot>
+    void addEllipsePlot(Plot& plot, const ArcRange& arc, const IPoint& origin, const int32_t x, const int32_t y) {
+        if (x == 0) {
+            arc.applyShared(plot, 0, 1, origin, 0, y);
+            if (y != 0) {
+                arc.applyShared(plot, 2, 3, origin, 0, -y);
+            }
+            return;
+        }
+        if (y == 0) {
+            arc.applyShared(plot, 3, 0, origin, x, 0);
+            arc.applyShared(plot, 1, 2, origin, -x, 0);
+            return;
+        }
+        arc.apply(plot, 0, origin, x, y);
+        arc.apply(plot, 1, origin, -x, y);
+        arc.apply(plot, 3, origin, x, -y);
+        arc.apply(plot, 2, origin, -x, -y);
+    }
+
+    // Midpoint ellipse with radii rx, ry, restricted to arc. Region 1 steps x while the slope is
+    // above -1, region 2 steps y. The decision values are scaled by 4 to stay integer.
+    template <typename Plot>
+    void plotEllipseArc(const IPoint& origin, const int rx, const int ry, const ArcRange& arc, Plot plot) {
+        if (rx < 1 || ry < 1 || arc.empty) {
+            return;
+        }
+
+        const int64_t a2 = int64_t(rx) * rx;
+        const int64_t b2 = int64_t(ry) * ry;
+        int64_t x = 0, y = ry;
+        int64_t d = 4 * b2 - 4 * a2 * ry + a2;
+        while (b2 * x < a2 * y) {
+            addEllipsePlot(plot, arc, origin, int32_t(x), int32_t(y));
+            if (d < 0) {
+                d += 4 * b2 * (2 * x + 3);
+            }
+            else {
+                d += 4 * b2 * (2 * x + 3) + 4 * a2 * (2 - 2 * y);
+                --y;
+            }
+            ++x;
+        }
+
+        d = b2 * (2 * x + 1) * (2 * x + 1) + 4 * a2 * (y - 1) * (y - 1) - 4 * a2 * b2;
+        while (y >= 0) {
+            addEllipsePlot(plot, arc, origin, int32_t(x), int32_t(y));
+            if (d > 0) {
+                d += 4 * a2 * (3 - 2 * y);
+            }
+            else {
+                d += 4 * b2 * (2 * x + 2) + 4 * a2 * (3 - 2 * y);
+                ++x;
+            }
+            --y;
+        }
+        // Very flat ellipses reach y = 0 before x = rx, finish the tip along the axis
+        for (++x; x <= rx; ++x) {
+            addEllipsePlot(plot, arc, origin, int32_t(x), 0);
+        }
+    }
+
+    template <typename Plot>
+    void plotEllipse(const IPoint& origin, const int rx, const int ry, Plot plot) {
+        plotEllipseArc(origin, rx, ry, arcRange(0.0, TWO_PI, 4), plot);
+    }
+
+    template <typename Plot>
+    void plotEllipseArc(const IPoint& origin, const int rx, const int ry, const double start, const double end, Plot plot) {
+        plotEllipseArc(origin, rx, ry, arcRange(start, end, 4), plot);
+    }
+
+    // Clipping of the curves below, like plotCircle: the bounding box of the whole curve around
+    // o rejects or accepts it at once, other curves test every pixel against clip
+    template <typename Plot>
+    struct ClippedPlot {
+        const bbox* clip;
+        Plot* plot;
+        bool visible, inside;
+
+        ClippedPlot(const IPoint& o, const int rx, const int ry, const bbox& _clip, Plot& _plot)
+            : clip(&_clip), plot(&_plot) {
+            bbox box;
+            box.xmin = o.x - rx;
+            box.xmax = o.x + rx;
+            box.ymin = o.y - ry;
+            box.ymax = o.y + ry;
+            const bbox v = Clipping::intersect(box, _clip);
+            visible = !Clipping::isEmpty(v);
+            inside = v.xmin == box.xmin && v.xmax == box.xmax && v.ymin == box.ymin && v.ymax == box.ymax;
+        }
+
+        void operator () (const int x, const int y) const {
+            if (inside || Clipping::contains(*clip, x, y)) {
+                (*plot)(x, y);
+            }
+        }
+    };
+
+    // Float origins are rounded to the nearest pixel
+    template <typename Plot>
+    void plotArc(const Point& origin, const int R, const double start, const double end, Plot plot) {
+        plotArc(toPixel(origin), R, start, end, plot);
+    }
+
+    template <typename Plot>
+    void plotArc(const Point& origin, const int R, const double start, const double end, const bbox& clip, Plot plot) {
+        const IPoint o = toPixel(origin);
+        const ClippedPlot<Plot> clipped(o, R, R, clip, plot);
+        if (clipped.visible) {
+            plotArc(o, R, start, end, clipped);
+        }
+    }
+
+    template <typename Plot>
+    void plotEllipse(const Point& origin, const int rx, const int ry, Plot plot) {
+        plotEllipse(toPixel(origin), rx, ry, plot);
+    }
+
+    template <typename Plot>
+    void plotEllipse(const Point& origin, const int rx, const int ry, const bbox& clip, Plot plot) {
+        const IPoint o = toPixel(origin);
+        const ClippedPlot<Plot> clipped(o, rx, ry, clip, plot);
+        if (clipped.visible) {
+            plotEllipse(o, rx, ry, clipped);
+        }
+    }
+
+    template <typename Plot>
+    void plotEllipseArc(const Point& origin, const int rx, const int ry, const double start, const double end, Plot plot) {
+        plotEllipseArc(toPixel(origin), rx, ry, start, end, plot);
+    }
+
+    template <typename Plot>
+    void plotEllipseArc(const Point& origin, const int rx, const int ry, const double start, const double end,
+                        const bbox& clip, Plot plot) {
+        const IPoint o = toPixel(origin);
+        const ClippedPlot<Plot> clipped(o, rx, ry, clip, plot);
+        if (clipped.visible) {
+            plotEllipseArc(o, rx, ry, start, end, clipped);
+        }
+    }
+
+    // 3D float writer for the curve generators
+    template <typename OutIt>
+    struct FloatPlot {
+        OutIt* out;
+
+        void operator () (const int x, const int y) const {
+            *(*out)++ = static_cast<float>(x);
+            *(*out)++ = static_cast<float>(y);
+            *(*out)++ = 0.0f;
+        }
+    };
+
+    template <typename OutIt>
+    FloatPlot<OutIt> floatPlot(OutIt& out) {
+        FloatPlot<OutIt> p = { &out };
+        return p;
+    }
+
+    // Same API as genCircleData. The pixels do not depend on the origin, so the sizes are
+    // counted around (0, 0).
+    size_t arcDataSize(const int R, const double start, const double end) {
+        size_t count = 0;
+        plotArc(IPoint(0, 0), R, start, end, [&count](const int, const int) { ++count; });
+        return 3 * count;
+    }
+
+    template <typename OutIt>
+    OutIt genArcData(const Point& origin, const int R, const double start, const double end, OutIt out) {
+        plotArc(origin, R, start, end, floatPlot(out));
+        return out;
+    }
+
+    std::vector<float> genArcData(const Point& origin, const int R, const double start, const double end) {
+        std::vector<float> data(arcDataSize(R, start, end));
+        genArcData(origin, R, start, end, data.data());
+        return data;
+    }
+
+    size_t arcDataSize(const Point& origin, const int R, const double start, const double end, const bbox& clip) {
+        size_t count = 0;
+        plotArc(origin, R, start, end, clip, [&count](const int, const int) { ++count; });
+        return 3 * count;
+    }
+
+    template <typename OutIt>
+    OutIt genArcData(const Point& origin, const int R, const double start, const double end, const bbox& clip, OutIt out) {
+        plotArc(origin, R, start, end, clip, floatPlot(out));
+        return out;
+    }
+
+    std::vector<float> genArcData(const Point& origin, const int R, const double start, const double end, const bbox& clip) {
+        std::vector<float> data(arcDataSize(origin, R, start, end, clip));
+        genArcData(origin, R, start, end, clip, data.data());
+        return data;
+    }
+
+    size_t ellipseDataSize(const int rx, const int ry) {
+        size_t count = 0;
+        plotEllipse(IPoint(0, 0), rx, ry, [&count](const int, const int) { ++count; });
+        return 3 * count;
+    }
+
+    template <typename OutIt>
+    OutIt genEllipseData(const Point& origin, const int rx, const int ry, OutIt out) {
+        plotEllipse(origin, rx, ry, floatPlot(out));
+        return out;
+    }
+
+    std::vector<float> genEllipseData(const Point& origin, const int rx, const int ry) {
+        std::vector<float> data(ellipseDataSize(rx, ry));
+        genEllipseData(origin, rx, ry, data.data());
+        return data;
+    }
+
+    size_t ellipseDataSize(const Point& origin, const int rx, const int ry, const bbox& clip) {
+        size_t count = 0;
+        plotEllipse(origin, rx, ry, clip, [&count](const int, const int) { ++count; });
+        return 3 * count;
+    }
+
+    template <typename OutIt>
+    OutIt genEllipseData(const Point& origin, const int rx, const int ry, const bbox& clip, OutIt out) {
+        plotEllipse(origin, rx, ry, clip, floatPlot(out));
+        return out;
+    }
+
+    std::vector<float> genEllipseData(const Point& origin, const int rx, const int ry, const bbox& clip) {
+        std::vector<float> data(ellipseDataSize(origin, rx, ry, clip));
+        genEllipseData(origin, rx, ry, clip, data.data());
+        return data;
+    }
+
+    size_t ellipseArcDataSize(const int rx, const int ry, const double start, const double end) {
+        size_t count = 0;
+        plotEllipseArc(IPoint(0, 0), rx, ry, start, end, [&count](const int, const int) { ++count; });
+        return 3 * count;
+    }
+
+    template <typename OutIt>
+    OutIt genEllipseArcData(const Point& origin, const int rx, const int ry, const double start, const double end, OutIt out) {
+        plotEllipseArc(origin, rx, ry, start, end, floatPlot(out));
+        return out;
+    }
+
+    std::vector<float> genEllipseArcData(const Point& origin, const int rx, const int ry, const double start, const double end) {
+        std::vector<float> data(ellipseArcDataSize(rx, ry, start, end));
+        genEllipseArcData(origin, rx, ry, start, end, data.data());
+        return data;
+    }
+
+    size_t ellipseArcDataSize(const Point& origin, const int rx, const int ry, const double start, const double end,
+                              const bbox& clip) {
+        size_t count = 0;
+        plotEllipseArc(origin, rx, ry, start, end, clip, [&count](const int, const int) { ++count; });
+        return 3 * count;
+    }
+
+    template <typename OutIt>
+    OutIt genEllipseArcData(const Point& origin, const int rx, const int ry, const double start, const double end,
+                            const bbox& clip, OutIt out) {
+        plotEllipseArc(origin, rx, ry, start, end, clip, floatPlot(out));
+        return out;
+    }
+
+    std::vector<float> genEllipseArcData(const Point& origin, const int rx, const int ry, const double start,
+                                         const double end, const bbox& clip) {
+        std::vector<float> data(ellipseArcDataSize(origin, rx, ry, start, end, clip));
+        genEllipseArcData(origin, rx, ry, start, end, clip, data.data());
+        return data;
+    }
+}
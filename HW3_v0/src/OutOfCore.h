@@ -0,0 +1,226 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "OnlyPoints.h"
+#include "Framebuffer.h"
+#include "Parallel.h"
+#include "MappedFile.h"
+
+// Line rasterization of segment files too large for RAM, into an image too large for RAM.
+// The image is cut into square tiles and produced one band of tile rows at a time, top band
+// first. For every band the memory-mapped input is read in chunks: the segments of a chunk are
+// binned into the tiles they may touch, then the tiles are rasterized in parallel, one thread
+// per tile. Finished tiles are handed to the caller and dropped. Peak memory is one band of
+// 1-bit tiles, one mapped chunk and its bins, whatever the input size. The price is one pass
+// over the input per band, so the band is made as tall as the memory budget allows.
+namespace OutOfCore {
+    // File layout: a 16-byte header ("SEG1", 4 reserved bytes, uint64 segment count) then one
+    // record per segment. Values are little endian. Coordinates are image pixels with (0, 0)
+    // the bottom-left pixel, like framebuffer coordinates.
+    const char MAGIC[4] = { 'S', 'E', 'G', '1' };
+    const size_t HEADER_SIZE = 16;
+
+    struct SegmentRecord {
+        float x0, y0, x1, y1;
+    };
+
+    // Streams records to disk, the count in the header is filled in by close()
+    class SegmentFileWriter
+    {
+    public:
+        SegmentFileWriter() : file(NULL), count(0) {}
+        ~SegmentFileWriter() { close(); }
+
+        bool open(const std::string& path) {
+            close();
+            file = fopen(path.c_str(), "wb");
+            if (file == NULL) {
+                return false;
+            }
+            count = 0;
+            return writeHeader();
+        }
+
+        bool add(const Point& v0, const Point& v1) {
+            const SegmentRecord r = { v0.x, v0.y, v1.x, v1.y };
+            ++count;
+            return fwrite(&r, sizeof(r), 1, file) == 1;
+        }
+
+        bool close() {
+            if (file == NULL) {
+                return true;
+            }
+            bool ok = fseek(file, 0, SEEK_SET) == 0 && writeHeader();
+            ok = fclose(file) == 0 && ok;
+            file = NULL;
+            return ok;
+        }
+
+    private:
+        FILE* file;
+        uint64_t count;
+
+        bool writeHeader() {
+            uint8_t header[HEADER_SIZE] = { 0 };
+            std::memcpy(header, MAGIC, 4);
+            std::memcpy(header + 8, &count, 8);
+            return fwrite(header, 1, HEADER_SIZE, file) == HEADER_SIZE;
+        }
+    };
+
+    class SegmentFile
+    {
+    public:
+        SegmentFile() : segmentCount(0) {}
+
+        bool open(const std::string& path) {
+            segmentCount = 0;
+            if (!file.open(path) || file.size() < HEADER_SIZE) {
+                return false;
+            }
+            const uint8_t* header = file.map(0, HEADER_SIZE);
+            if (header == NULL || std::memcmp(header, MAGIC, 4) != 0) {
+                return false;
+            }
+            std::memcpy(&segmentCount, header + 8, 8);
+            file.unmap();
+            return file.size() - HEADER_SIZE >= segmentCount * sizeof(SegmentRecord);
+        }
+
+        uint64_t size() const { return segmentCount; }
+
+        // Map segments [first, first + n), valid until the next call
+        const SegmentRecord* map(const uint64_t first, const size_t n) {
+            return reinterpret_cast<const SegmentRecord*>(
+                file.map(HEADER_SIZE + first * sizeof(SegmentRecord), n * sizeof(SegmentRecord)));
+        }
+
+    private:
+        MappedFile file;
+        uint64_t segmentCount;
+    };
+
+    struct Options {
+        int width, height;
+        int tileSize;
+        // Bytes of tile storage per band, at least one row of tiles is always used
+        size_t bandBytes;
+        // Segments mapped and binned at once
+        size_t chunkSegments;
+        unsigned threads;
+
+        Options(const int _width, const int _height)
+            : width(_width), height(_height), tileSize(256), bandBytes(size_t(64) << 20),
+              chunkSegments(size_t(1) << 20), threads(0) {}
+    };
+
+    // Pixels a line can touch, in image coordinates. plotLine rounds the endpoints to 1/16
+    // pixel and the end pixels may be half a pixel past them, one pixel of margin covers both.
+    // Coordinates are clamped to Clipping::unbounded() so far away segments cannot overflow.
+    bbox segmentBounds(const SegmentRecord& s) {
+        const double limit = double(Clipping::unbounded().xmax);
+        auto clamp = [limit](const double v) { return static_cast<int>(std::min(std::max(v, -limit), limit)); };
+        bbox b;
+        b.xmin = clamp(std::floor(std::min(s.x0, s.x1)) - 1);
+        b.xmax = clamp(std::ceil(std::max(s.x0, s.x1)) + 1);
+        b.ymin = clamp(std::floor(std::min(s.y0, s.y1)) - 1);
+        b.ymax = clamp(std::ceil(std::max(s.y0, s.y1)) + 1);
+        return b;
+    }
+
+    // Rasterize every segment of input with Bresenham::plotLine. writeTile(column, row, tile) is
+    // called once per tile, with row 0 the top row of tiles, and may be called from several
+    // threads at once. Tiles on the right and top edges are cut to the image size.
+    // Return false if the input cannot be mapped.
+    template <typename WriteTile>
+    bool rasterize(SegmentFile& input, const Options& opt, WriteTile writeTile) {
+        const int tileSize = opt.tileSize;
+        const int tilesX = (opt.width + tileSize - 1) / tileSize;
+        const int tilesY = (opt.height + tileSize - 1) / tileSize;
+        const size_t tileBytes = size_t((tileSize + 63) / 64) * 8 * tileSize;
+        const int bandRows = int(std::max<size_t>(1, std::min<size_t>(tilesY, opt.bandBytes / (tileBytes * tilesX))));
+        const size_t chunkSegments = std::max<size_t>(opt.chunkSegments, 1);
+
+        std::vector<CoverageBuffer> tiles;
+        std::vector<std::vector<uint32_t>> bins;
+        // Bands run from the top of the image down, rows are counted from the bottom here
+        for (int bandTop = tilesY - 1; bandTop >= 0; bandTop -= bandRows) {
+            const int bandBottom = std::max(bandTop - bandRows + 1, 0);
+
+            tiles.clear();
+            for (int ty = bandBottom; ty <= bandTop; ++ty) {
+                for (int tx = 0; tx < tilesX; ++tx) {
+                    tiles.push_back(CoverageBuffer(std::min(tileSize, opt.width - tx * tileSize),
+                                                   std::min(tileSize, opt.height - ty * tileSize)));
+                }
+            }
+            bins.resize(tiles.size());
+
+            bbox band;
+            band.xmin = 0;
+            band.xmax = opt.width - 1;
+            band.ymin = bandBottom * tileSize;
+            band.ymax = std::min((bandTop + 1) * tileSize, opt.height) - 1;
+
+            for (uint64_t first = 0; first < input.size(); first += chunkSegments) {
+                const size_t n = size_t(std::min<uint64_t>(chunkSegments, input.size() - first));
+                const SegmentRecord* segments = input.map(first, n);
+                if (segments == NULL) {
+                    return false;
+                }
+
+                for (auto& bin : bins) {
+                    bin.clear();
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    const SegmentRecord& s = segments[i];
+                    if (!(std::isfinite(s.x0) && std::isfinite(s.y0) && std::isfinite(s.x1) && std::isfinite(s.y1))) {
+                        continue;
+                    }
+                    const bbox b = Clipping::intersect(segmentBounds(s), band);
+                    if (Clipping::isEmpty(b)) {
+                        continue;
+                    }
+                    for (int ty = b.ymin / tileSize; ty <= b.ymax / tileSize; ++ty) {
+                        for (int tx = b.xmin / tileSize; tx <= b.xmax / tileSize; ++tx) {
+                            bins[(ty - bandBottom) * tilesX + tx].push_back(uint32_t(i));
+                        }
+                    }
+                }
+
+                Parallel::parallelFor(int(tiles.size()), [&](const int t) {
+                    if (bins[t].empty()) {
+                        return;
+                    }
+                    // The tile in image coordinates, lines are clipped to it
+                    const int x0 = (t % tilesX) * tileSize;
+                    const int y0 = (bandBottom + t / tilesX) * tileSize;
+                    CoverageBuffer& tile = tiles[t];
+                    bbox tileRect;
+                    tileRect.xmin = x0;
+                    tileRect.xmax = x0 + tile.width - 1;
+                    tileRect.ymin = y0;
+                    tileRect.ymax = y0 + tile.height - 1;
+                    for (const uint32_t i : bins[t]) {
+                        const SegmentRecord& s = segments[i];
+                        Bresenham::plotLine(Point(s.x0, s.y0), Point(s.x1, s.y1), tileRect,
+                            [&tile, x0, y0](const int x, const int y) {
+                                tile.setPixel(x - x0, y - y0, true);
+                            });
+                    }
+                }, opt.threads);
+            }
+
+            Parallel::parallelFor(int(tiles.size()), [&](const int t) {
+                const int ty = bandBottom + t / tilesX;
+                writeTile(t % tilesX, tilesY - 1 - ty, tiles[t]);
+            }, opt.threads);
+        }
+        return true;
+    }
+}
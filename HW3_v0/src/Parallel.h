@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+namespace Parallel {
+    // 0 means one thread per hardware core
+    unsigned threadCount(const unsigned requested = 0) {
+        if (requested > 0) {
+            return requested;
+        }
+        const unsigned cores = std::thread::hardware_concurrency();
+        return cores > 0 ? cores : 1;
+    }
+
+    // Call func(i) for every i in [0, n). Items are handed out one at a time, so
+    // uneven items (e.g. tiles with many triangles) still balance across threads.
+    template <typename Func>
+    void parallelFor(const int n, Func func, const unsigned requested = 0) {
+        const unsigned threads = std::min<unsigned>(threadCount(requested), n > 0 ? n : 1);
+        std::atomic<int> next(0);
+        auto worker = [&next, n, &func]() {
+            for (int i = next++; i < n; i = next++) {
+                func(i);
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) {
+            pool.push_back(std::thread(worker));
+        }
+        worker();
+        for (auto& t : pool) {
+            t.join();
+        }
+    }
+}
@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;
+
+// Framebuffer size in pixels, the points are screen coordinates with (0, 0) at the center
+uniform vec2 viewport;
+
+void main()
+{
+    gl_Position = vec4(2.0 * aPos / viewport, 0.0, 1.0);
+}
\ No newline at end of file
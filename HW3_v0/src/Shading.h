@@ -0,0 +1,178 @@
+#pragma once
+#include <algorithm>
+#include "OnlyPoints.h"
+#include "Framebuffer.h"
+
+// Interpolated vertex attributes on top of the triangle scan in OnlyPoints.h, so the CPU
+// rasterizer can shade (color, UV, depth) instead of only listing covered pixels. Coverage is
+// exactly that of TriangleRasterization::scanTriangleSpansClipped, top-left rule included.
+//
+// The barycentric coordinate of a vertex is the edge function of the opposite edge, scaled to
+// be 1 at that vertex. A value given at the vertices is then a plane in screen space, which is
+// stepped along every span instead of being evaluated from scratch at each pixel. Attributes
+// are not linear in screen space under a perspective projection but attr / w and 1 / w are, so
+// both are stepped and divided per pixel. Depth is already divided by w and is stepped as is.
+namespace Shading {
+    const int MAX_ATTRIBUTES = 8;
+
+    // A projected vertex. p is in screen coordinates, z the depth in [0, 1] after the divide by
+    // w and w the clip-space w (1 for an orthographic view). Triangles must be clipped against
+    // the near plane first, w > 0. attr holds the color, UV or whatever else is interpolated.
+    struct Vertex {
+        Point p;
+        float z, w;
+        float attr[MAX_ATTRIBUTES];
+    };
+
+    // f(x, y) = dx * x + dy * y + c
+    struct Plane {
+        double dx, dy, c;
+    };
+
+    // The planes of one triangle. The attribute planes are padded with zeros to a multiple of 4
+    // channels so the SIMD path needs no tail.
+    struct Setup {
+        Plane z, invW;
+        alignas(16) float attrDx[MAX_ATTRIBUTES];
+        alignas(16) float attrDy[MAX_ATTRIBUTES];
+        alignas(16) float attrC[MAX_ATTRIBUTES];
+        int count;
+    };
+
+    Plane fitPlane(const double lambda[3][3], const double f0, const double f1, const double f2) {
+        Plane pl;
+        pl.dx = f0 * lambda[0][0] + f1 * lambda[1][0] + f2 * lambda[2][0];
+        pl.dy = f0 * lambda[0][1] + f1 * lambda[1][1] + f2 * lambda[2][1];
+        pl.c = f0 * lambda[0][2] + f1 * lambda[1][2] + f2 * lambda[2][2];
+        return pl;
+    }
+
+    // Return false for a degenerate triangle, which has no barycentric coordinates
+    bool setupTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, const int count, Setup& s) {
+        const Vertex* v[3] = { &v0, &v1, &v2 };
+        // lambda[i] is (A, B, C) of the edge opposite vertex i, divided by its value at vertex i
+        double lambda[3][3];
+        for (int i = 0; i < 3; ++i) {
+            const Point& a = v[(i + 1) % 3]->p;
+            const Point& b = v[(i + 2) % 3]->p;
+            const double A = double(a.y) - b.y;
+            const double B = double(b.x) - a.x;
+            const double C = double(a.x) * b.y - double(b.x) * a.y;
+            const double d = A * v[i]->p.x + B * v[i]->p.y + C;
+            if (d == 0.0) {
+                return false;
+            }
+            lambda[i][0] = A / d;
+            lambda[i][1] = B / d;
+            lambda[i][2] = C / d;
+        }
+
+        const double q0 = 1.0 / v0.w, q1 = 1.0 / v1.w, q2 = 1.0 / v2.w;
+        s.z = fitPlane(lambda, v0.z, v1.z, v2.z);
+        s.invW = fitPlane(lambda, q0, q1, q2);
+        s.count = std::min(std::max(count, 0), MAX_ATTRIBUTES);
+        for (int k = 0; k < MAX_ATTRIBUTES; ++k) {
+            Plane pl = { 0.0, 0.0, 0.0 };
+            if (k < s.count) {
+                pl = fitPlane(lambda, v0.attr[k] * q0, v1.attr[k] * q1, v2.attr[k] * q2);
+            }
+            s.attrDx[k] = static_cast<float>(pl.dx);
+            s.attrDy[k] = static_cast<float>(pl.dy);
+            s.attrC[k] = static_cast<float>(pl.c);
+        }
+        return true;
+    }
+
+    // Call test(x, y, z) for every covered pixel of the triangle inside clip, and for the pixels
+    // it accepts shade(x, y, z, attr) with the first count perspective-correct attributes.
+    // The test runs before the attributes are computed, like an early depth test.
+    template <typename Test, typename Shade>
+    void scanTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, const int count,
+                      const bbox& clip, Test test, Shade shade) {
+        Setup s;
+        if (!setupTriangle(v0, v1, v2, count, s)) {
+            return;
+        }
+        const int channels = (s.count + 3) / 4 * 4;
+
+        TriangleRasterization::scanTriangleSpansClipped(v0.p, v1.p, v2.p, clip,
+            [&](const int y, const int x0, const int x1) {
+                // Plane values at the span start, then one step per pixel
+                double z = s.z.dx * x0 + s.z.dy * y + s.z.c;
+                double invW = s.invW.dx * x0 + s.invW.dy * y + s.invW.c;
+                alignas(16) float start[MAX_ATTRIBUTES];
+                alignas(16) float attr[MAX_ATTRIBUTES];
+                for (int k = 0; k < channels; ++k) {
+                    start[k] = s.attrDx[k] * x0 + s.attrDy[k] * y + s.attrC[k];
+                }
+
+                for (int x = x0; x <= x1; ++x, z += s.z.dx, invW += s.invW.dx) {
+                    const float fz = static_cast<float>(z);
+                    if (!test(x, y, fz)) {
+                        continue;
+                    }
+                    // start + steps * dx rather than a running sum, so long spans do not drift
+                    const float steps = static_cast<float>(x - x0);
+                    const float w = static_cast<float>(1.0 / invW);
+                    int k = 0;
+#if ONLYPOINTS_SIMD_WIDTH >= 4
+                    const __m128 vsteps = _mm_set1_ps(steps);
+                    const __m128 vw = _mm_set1_ps(w);
+                    for (; k < channels; k += 4) {
+                        const __m128 value = _mm_add_ps(_mm_load_ps(start + k), _mm_mul_ps(vsteps, _mm_load_ps(s.attrDx + k)));
+                        _mm_store_ps(attr + k, _mm_mul_ps(value, vw));
+                    }
+#endif
+                    for (; k < channels; ++k) {
+                        attr[k] = (start[k] + steps * s.attrDx[k]) * w;
+                    }
+                    shade(x, y, fz, static_cast<const float*>(attr));
+                }
+            });
+    }
+
+    template <typename Shade>
+    void scanTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, const int count,
+                      const bbox& clip, Shade shade) {
+        scanTriangle(v0, v1, v2, count, clip, [](const int, const int, const float) { return true; }, shade);
+    }
+
+    // attr[0..2] as RGB in [0, 1], opaque
+    uint32_t colorFromAttributes(const float* attr) {
+        auto channel = [](const float c) {
+            return static_cast<uint8_t>(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+        };
+        return packRGBA(channel(attr[0]), channel(attr[1]), channel(attr[2]));
+    }
+
+    // Depth-tested (GL_LESS) write into target, color(attr) gives the packed color of a pixel.
+    // depth must have the size of target.
+    template <typename Color>
+    void drawTriangle(Framebuffer& target, DepthBuffer& depth, const Vertex& v0, const Vertex& v1,
+                      const Vertex& v2, const int count, Color color) {
+        const int ox = target.originX(), oy = target.originY();
+        const bbox clip = Draw::screenRect(target);
+        bool any = false;
+        scanTriangle(v0, v1, v2, count, clip,
+            [&depth, ox, oy](const int x, const int y, const float z) {
+                return depth.testAndSet(x + ox, y + oy, z);
+            },
+            [&](const int x, const int y, const float, const float* attr) {
+                target.setPixel(x + ox, y + oy, color(attr));
+                any = true;
+            });
+        // The clipped bbox rather than the exact pixels, the dirty area is only for uploads
+        if (any) {
+            bbox b;
+            TriangleRasterization::bound3(v0.p, v1.p, v2.p, b);
+            b = Clipping::intersect(b, clip);
+            target.markDirty(b.xmin + ox, b.ymin + oy, b.xmax + ox, b.ymax + oy);
+        }
+    }
+
+    // Vertex colors in attr[0..2]
+    void drawTriangle(Framebuffer& target, DepthBuffer& depth, const Vertex& v0, const Vertex& v1,
+                      const Vertex& v2) {
+        drawTriangle(target, depth, v0, v1, v2, 3, [](const float* attr) { return colorFromAttributes(attr); });
+    }
+}
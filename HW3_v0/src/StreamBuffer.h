@@ -0,0 +1,128 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstring>
+
+// Vertex (or pixel) data that changes every frame, without reallocating GPU storage and
+// without waiting for the GPU. One buffer object is split into SEGMENTS regions that are
+// written round robin: a write maps its region with GL_MAP_UNSYNCHRONIZED_BIT so the driver
+// never blocks, and a fence placed when the previous region is retired tells us when the GPU
+// is done with a region before we come back to it. With three regions that wait is normally
+// already over. Persistent mapping (GL_ARB_buffer_storage) would save the map calls too, but
+// it is GL 4.4 and our glad is generated for GL 3.3 core.
+class StreamBuffer
+{
+public:
+    static const int SEGMENTS = 3;
+    GLuint buffer;
+    GLenum target;
+
+    explicit StreamBuffer(const GLenum _target = GL_ARRAY_BUFFER, const GLsizeiptr _segmentSize = 64 * 1024)
+        : target(_target), segmentSize(0), current(0), mapped(false) {
+        glGenBuffers(1, &buffer);
+        for (int i = 0; i < SEGMENTS; ++i) {
+            fences[i] = 0;
+        }
+        allocate(_segmentSize);
+        glBindBuffer(target, 0);
+    }
+
+    ~StreamBuffer() {
+        release();
+    }
+
+    // Delete the fences and the buffer while the context is still current, the destructor
+    // of a StreamBuffer that outlives the context (a local of main() after glfwTerminate())
+    // then does nothing
+    void release() {
+        if (buffer == 0) {
+            return;
+        }
+        unmap();
+        clearFences();
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+
+    // Map room for bytes in the next region, the buffer stays bound to target. offset is where
+    // the data starts in the buffer, for glVertexAttribPointer or a pixel unpack offset.
+    // Call unmap() before drawing. Returns NULL if the driver could not map the buffer.
+    void* map(const GLsizeiptr bytes, GLintptr& offset) {
+        glBindBuffer(target, buffer);
+        if (bytes > segmentSize) {
+            // Grow: the old storage is orphaned, the driver keeps it alive for pending draws
+            allocate(bytes * 2);
+        }
+        else {
+            // Retire the region the pending draws read from, then take the next one
+            fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            current = (current + 1) % SEGMENTS;
+            waitFor(current);
+        }
+        offset = GLintptr(current) * segmentSize;
+        void* p = glMapBufferRange(target, offset, bytes > 0 ? bytes : 1,
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        mapped = p != NULL;
+        return p;
+    }
+
+    void unmap() {
+        if (mapped) {
+            glUnmapBuffer(target);
+            mapped = false;
+        }
+    }
+
+    // Copy bytes of data into the next region and return its offset, -1 on failure
+    GLintptr write(const void* data, const GLsizeiptr bytes) {
+        GLintptr offset;
+        void* dst = map(bytes, offset);
+        if (dst == NULL) {
+            return -1;
+        }
+        if (bytes > 0) {
+            memcpy(dst, data, size_t(bytes));
+        }
+        unmap();
+        return offset;
+    }
+
+private:
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer& operator = (const StreamBuffer&);
+
+    GLsizeiptr segmentSize;
+    int current;
+    bool mapped;
+    GLsync fences[SEGMENTS];
+
+    void allocate(const GLsizeiptr size) {
+        clearFences();
+        // Keep every region start aligned for any vertex format
+        segmentSize = (size + 255) / 256 * 256;
+        current = 0;
+        glBindBuffer(target, buffer);
+        glBufferData(target, segmentSize * SEGMENTS, NULL, GL_STREAM_DRAW);
+    }
+
+    void waitFor(const int i) {
+        if (fences[i] == 0) {
+            return;
+        }
+        // Flush on the first try so the fence is sure to signal
+        GLenum result = glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(fences[i], 0, 1000000);
+        }
+        glDeleteSync(fences[i]);
+        fences[i] = 0;
+    }
+
+    void clearFences() {
+        for (int i = 0; i < SEGMENTS; ++i) {
+            if (fences[i] != 0) {
+                glDeleteSync(fences[i]);
+                fences[i] = 0;
+            }
+        }
+    }
+};
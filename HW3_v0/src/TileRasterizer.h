@@ -0,0 +1,75 @@
+#pragma once
+#include "OnlyPoints.h"
+#include "Framebuffer.h"
+#include "Parallel.h"
+
+// Batch triangle rasterization into a Framebuffer.
+// Triangles are binned into square screen tiles first, then every tile is rasterized by
+// exactly one thread, so the threads write disjoint pixels and need no locks. Inside a tile
+// triangles are drawn in submission order, so the result does not depend on the thread count.
+// The edge tests follow the top-left rule, so triangles of a mesh never overdraw their shared edges.
+namespace TileRasterization {
+    const int DEFAULT_TILE_SIZE = 64;
+
+    // vertices holds 3 points per triangle in screen coordinates.
+    // colors holds one color per triangle, or a single color for all of them, anything else
+    // draws nothing.
+    void rasterizeTriangles(const std::vector<Point>& vertices, const std::vector<uint32_t>& colors,
+                            Framebuffer& fb, const int tileSize = DEFAULT_TILE_SIZE, const unsigned threads = 0) {
+        const int triCount = int(vertices.size() / 3);
+        // The workers read colors[t], check its size once here
+        if (triCount == 0 || (colors.size() != 1 && colors.size() != size_t(triCount))) {
+            return;
+        }
+
+        const int tilesX = (fb.width + tileSize - 1) / tileSize;
+        const int tilesY = (fb.height + tileSize - 1) / tileSize;
+        const int ox = fb.originX();
+        const int oy = fb.originY();
+
+        // Binning: bbox of each triangle in framebuffer coordinates, clamped to the framebuffer
+        // The workers write with setPixel(), so the dirty rectangle is grown here instead
+        std::vector<std::vector<int>> bins(tilesX * tilesY);
+        for (int t = 0; t < triCount; ++t) {
+            bbox b;
+            TriangleRasterization::bound3(vertices[3 * t], vertices[3 * t + 1], vertices[3 * t + 2], b);
+            b.xmin = std::max(b.xmin + ox, 0);
+            b.xmax = std::min(b.xmax + ox, fb.width - 1);
+            b.ymin = std::max(b.ymin + oy, 0);
+            b.ymax = std::min(b.ymax + oy, fb.height - 1);
+            if (b.xmin > b.xmax || b.ymin > b.ymax) {
+                continue;
+            }
+            fb.markDirty(b.xmin, b.ymin, b.xmax, b.ymax);
+            for (int ty = b.ymin / tileSize; ty <= b.ymax / tileSize; ++ty) {
+                for (int tx = b.xmin / tileSize; tx <= b.xmax / tileSize; ++tx) {
+                    bins[ty * tilesX + tx].push_back(t);
+                }
+            }
+        }
+
+        Parallel::parallelFor(tilesX * tilesY, [&](const int tile) {
+            const int tx = tile % tilesX;
+            const int ty = tile / tilesX;
+            const int x0 = tx * tileSize;
+            const int y0 = ty * tileSize;
+            const int x1 = std::min(x0 + tileSize, fb.width) - 1;
+            const int y1 = std::min(y0 + tileSize, fb.height) - 1;
+
+            // The tile in screen coordinates, every triangle is clipped to it
+            bbox tileRect;
+            tileRect.xmin = x0 - ox;
+            tileRect.xmax = x1 - ox;
+            tileRect.ymin = y0 - oy;
+            tileRect.ymax = y1 - oy;
+
+            for (const int t : bins[tile]) {
+                const uint32_t color = colors.size() > 1 ? colors[t] : colors[0];
+                TriangleRasterization::scanTriangleClipped(vertices[3 * t], vertices[3 * t + 1], vertices[3 * t + 2], tileRect,
+                    [&fb, ox, oy, color](const int x, const int y) {
+                        fb.setPixel(x + ox, y + oy, color);
+                    });
+            }
+        }, threads);
+    }
+}
@@ -5,6 +5,10 @@
 #include "imgui/imgui.h"
 #include "imgui_impl_glfw_gl3.h"
 #include "OnlyPoints.h"
+#include "Framebuffer.h"
+#include "FramebufferTexture.h"
+#include "CircleCache.h"
+#include "StreamBuffer.h"
 #include <iostream>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -15,13 +19,33 @@ static void glfw_error_callback(int error, const char* description)
     fprintf(stderr, "Error %d: %s\n", error, description);
 }
 
-void pointData2vao(const GLuint& VAO, const GLuint& VBO, std::vector<GLfloat>& data) {
+// The data goes into the next region of stream, the VAO is pointed at it.
+// Return the number of vertices to draw, 0 if the buffer could not be mapped.
+GLsizei pointData2vao(const GLuint& VAO, StreamBuffer& stream, const std::vector<GLfloat>& data) {
+    const GLintptr offset = stream.write(data.data(), data.size() * sizeof(GLfloat));
+    if (offset < 0) {
+        return 0;
+    }
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)offset);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    return GLsizei(data.size() / 3);
+}
+
+// Packed pixels, two int16_t screen coordinates per point, see Shader/packed.vs
+GLsizei pointData2vao(const GLuint& VAO, StreamBuffer& stream, const std::vector<GLshort>& data) {
+    const GLintptr offset = stream.write(data.data(), data.size() * sizeof(GLshort));
+    if (offset < 0) {
+        return 0;
+    }
     glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), data.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+    glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, 2 * sizeof(GLshort), (void*)offset);
     glEnableVertexAttribArray(0);
     glBindVertexArray(0);
+    return GLsizei(data.size() / 2);
 }
 
 static void ShowHelpMarker(const char* desc)
@@ -77,12 +101,16 @@ int main()
 
     // 创造着色器程序
     Shader my_shader = Shader(".\\Shader\\shader.vs", ".\\Shader\\shader.fs");
+    Shader texture_shader = Shader(".\\Shader\\texture.vs", ".\\Shader\\texture.fs");
+    Shader packed_shader = Shader(".\\Shader\\packed.vs", ".\\Shader\\shader.fs");
 
     // 所有任务的VAOs构建
-    GLuint VAO[2];
-    GLuint VBO[2];
-    glGenVertexArrays(2, VAO);
-    glGenBuffers(2, VBO);
+    // VAO[0]/VAO[1]: triangle/circle points, VAO[2]/VAO[3]: triangle/circle fill spans
+    GLuint VAO[4];
+    StreamBuffer VBO[4];
+    // What pointData2vao could upload, nothing is drawn from a VAO whose upload failed
+    GLsizei vertexCount[4] = { 0, 0, 0, 0 };
+    glGenVertexArrays(4, VAO);
 
     // Mode 1: Triangle
     GLfloat tri2dVex[] = {
@@ -91,21 +119,59 @@ int main()
         200.0, -70.0
     };
     bool isFilled = false;
-    auto triData = Bresenham::genTriangleData(
-        Point(tri2dVex[0], tri2dVex[1]),
-        Point(tri2dVex[2], tri2dVex[3]),
-        Point(tri2dVex[4], tri2dVex[5]),
-        isFilled
-    );
-    pointData2vao(VAO[0], VBO[0], Utils::scrCoor2glCoor(triData, SCR_WIDTH, SCR_HEIGHT));
+    // Draw the fill as one GL_LINES segment per row instead of one point per pixel
+    bool isSpanMode = false;
+    // The pixels are uploaded as int16_t pairs, the span lines stay float for their half-pixel ends
+    std::vector<GLshort> triData;
+    std::vector<float> triSpanData;
+    // Texture display: the shapes are rasterized into fb on the CPU and shown as one quad
+    bool isTextureMode = false;
+    bool isFramebufferStale = true;
+    auto updateTriangle = [&](const int scr_width, const int scr_height) {
+        const bbox screen = Clipping::viewport(scr_width, scr_height);
+        Point p0(tri2dVex[0], tri2dVex[1]);
+        Point p1(tri2dVex[2], tri2dVex[3]);
+        Point p2(tri2dVex[4], tri2dVex[5]);
+        triSpanData.clear();
+        const bool isPointFill = isFilled && !isSpanMode;
+        if (isFilled && isSpanMode) {
+            triSpanData = Utils::spans2lines3d(TriangleRasterization::edgeEquationsSpans(p0, p1, p2, screen));
+        }
+        triData.resize(Utils::floats3d2shortsSize(Bresenham::triangleDataSize(p0, p1, p2, isPointFill, screen)));
+        Bresenham::genTriangleData(p0, p1, p2, isPointFill, screen, Utils::ShortPointWriter(triData.data()));
+        vertexCount[0] = pointData2vao(VAO[0], VBO[0], triData);
+        vertexCount[2] = pointData2vao(VAO[2], VBO[2], Utils::scrCoor2glCoor(triSpanData, scr_width, scr_height));
+        isFramebufferStale = true;
+    };
+    updateTriangle(SCR_WIDTH, SCR_HEIGHT);
+    // Set when the vertices moved while only the framebuffer was kept up to date
+    bool isTriangleDataStale = false;
+    // The vertex held with the left mouse button, -1 for none
+    int draggedVertex = -1;
 
     // Mode 2: Circle
     // input paras
     GLint radius = 100;
     Point origin = Point(0.0f, 0.0f);
-
-    auto circleData = Bresenham::genCircleData(origin, radius);
-    pointData2vao(VAO[1], VBO[1], Utils::scrCoor2glCoor(circleData, SCR_WIDTH, SCR_HEIGHT));
+    // Filled circles are always drawn as spans
+    bool isCircleFilled = false;
+    std::vector<GLshort> circleData;
+    std::vector<float> circleSpanData;
+    // Dragging the radius slider back and forth hits the same few radii
+    CircleCache circleCache;
+    auto updateCircle = [&](const int scr_width, const int scr_height) {
+        const bbox screen = Clipping::viewport(scr_width, scr_height);
+        circleData.resize(Utils::floats3d2shortsSize(circleCache.circleDataSize(origin, radius, screen)));
+        circleCache.genCircleData(origin, radius, screen, Utils::ShortPointWriter(circleData.data()));
+        circleSpanData.clear();
+        if (isCircleFilled) {
+            circleSpanData = Utils::spans2lines3d(Bresenham::genFilledCircleSpans(origin, radius, screen));
+        }
+        vertexCount[1] = pointData2vao(VAO[1], VBO[1], circleData);
+        vertexCount[3] = pointData2vao(VAO[3], VBO[3], Utils::scrCoor2glCoor(circleSpanData, scr_width, scr_height));
+        isFramebufferStale = true;
+    };
+    updateCircle(SCR_WIDTH, SCR_HEIGHT);
 
     // Imgui 的设置
     // Setup ImGui binding
@@ -122,7 +188,73 @@ int main()
     ImVec4 clear_color = ImVec4(1.0f, 1.0f, 1.0f, 1.0f);
 
     int mode = 0;
+
+    // Same colors as shader.fs and the clear color
+    const uint32_t shapeColor = packRGBA(51, 153, 204);
+    const uint32_t backgroundColor = packRGBA(255, 255, 255);
+    Framebuffer fb(SCR_WIDTH, SCR_HEIGHT, backgroundColor);
+    FramebufferTexture fbTexture(SCR_WIDTH, SCR_HEIGHT);
+    // The area the current shape was drawn to, erased before the next one is drawn
+    bbox drawnRect;
+    bool hasDrawn = false;
+    auto redrawFramebuffer = [&]() {
+        if (hasDrawn) {
+            fb.fillRect(drawnRect, backgroundColor);
+        }
+        // Measure what the new shape touches, then merge it back into the pending upload
+        const bool hadDirty = fb.hasDirty;
+        const bbox erased = fb.dirty;
+        fb.resetDirty();
+        if (mode == 0) {
+            Draw::triangle(fb, Point(tri2dVex[0], tri2dVex[1]), Point(tri2dVex[2], tri2dVex[3]),
+                           Point(tri2dVex[4], tri2dVex[5]), shapeColor, isFilled);
+        }
+        else {
+            Draw::circle(fb, origin, radius, shapeColor, isCircleFilled);
+        }
+        hasDrawn = fb.hasDirty;
+        drawnRect = fb.dirty;
+        if (hadDirty) {
+            fb.markDirty(erased.xmin, erased.ymin, erased.xmax, erased.ymax);
+        }
+        isFramebufferStale = false;
+    };
+
+    // Move vertex k of the triangle to screen position (x, y). In texture mode only the union of
+    // the old and new bounds is cleared and redrawn, and the upload is that rectangle too.
+    auto moveVertex = [&](const int k, const float x, const float y, const int scr_width, const int scr_height) {
+        const bbox before = Draw::triangleBounds(Point(tri2dVex[0], tri2dVex[1]), Point(tri2dVex[2], tri2dVex[3]),
+                                                 Point(tri2dVex[4], tri2dVex[5]));
+        tri2dVex[2 * k] = x;
+        tri2dVex[2 * k + 1] = y;
+        if (!isTextureMode) {
+            updateTriangle(scr_width, scr_height);
+            return;
+        }
+        isTriangleDataStale = true;
+        if (isFramebufferStale || mode != 0) {
+            return;
+        }
+
+        const Point p0(tri2dVex[0], tri2dVex[1]), p1(tri2dVex[2], tri2dVex[3]), p2(tri2dVex[4], tri2dVex[5]);
+        const bbox area = Clipping::intersect(Clipping::unite(before, Draw::triangleBounds(p0, p1, p2)), Draw::screenRect(fb));
+        if (Clipping::isEmpty(area)) {
+            return;
+        }
+        bbox fbArea = area;
+        fbArea.xmin += fb.originX();
+        fbArea.xmax += fb.originX();
+        fbArea.ymin += fb.originY();
+        fbArea.ymax += fb.originY();
+        fb.fillRect(fbArea, backgroundColor);
+        Draw::triangle(fb, p0, p1, p2, shapeColor, isFilled, area);
+        drawnRect = hasDrawn ? Clipping::unite(drawnRect, fbArea) : fbArea;
+        hasDrawn = true;
+    };
+
     bool isChecked = isFilled;
+    bool isSpanChecked = isSpanMode;
+    bool isCircleChecked = isCircleFilled;
 
     // render loop
     // -----------
@@ -153,29 +285,36 @@ int main()
             ImGui::Text("Choose the following mode you want.");
 
             // 模式选择框
-            if (ImGui::Button("Triangle"))
+            if (ImGui::Button("Triangle")) {
                 mode = 0;
+                isFramebufferStale = true;
+            }
 
             ImGui::SameLine();
-            if (ImGui::Button("Circle"))
+            if (ImGui::Button("Circle")) {
                 mode = 1;
+                isFramebufferStale = true;
+            }
+
+            ImGui::Checkbox("Texture Display", &isTextureMode);
+            if (!isTextureMode && isTriangleDataStale) {
+                updateTriangle(scr_width, scr_height);
+                isTriangleDataStale = false;
+            }
+            ImGui::SameLine(); ShowHelpMarker("Rasterize on the CPU into a framebuffer and draw it as one texture,\nonly the changed rectangle is uploaded.\n");
 
             int curr_radius = radius;
             switch (mode)
             {
             case 0:
                 // 单三角形模式下的选择框
+                ImGui::Text("Drag the vertices with the left mouse button");
                 ImGui::Checkbox("Is Filled", &isChecked);
-                if (isChecked != isFilled) {
-                    triData.clear();
-                    triData = Bresenham::genTriangleData(
-                        Point(tri2dVex[0], tri2dVex[1]),
-                        Point(tri2dVex[2], tri2dVex[3]),
-                        Point(tri2dVex[4], tri2dVex[5]),
-                        isChecked
-                    );
-                    pointData2vao(VAO[0], VBO[0], Utils::scrCoor2glCoor(triData, scr_width, scr_height));
+                ImGui::Checkbox("Fill With Spans", &isSpanChecked);
+                if (isChecked != isFilled || isSpanChecked != isSpanMode) {
                     isFilled = isChecked;
+                    isSpanMode = isSpanChecked;
+                    updateTriangle(scr_width, scr_height);
                 }
                 break;
             case 1:
@@ -183,15 +322,16 @@ int main()
                 ImGui::InputInt("Radius", &curr_radius);
                 ImGui::SameLine(); ShowHelpMarker("You can apply arithmetic operators +,*,/ on numerical values.\n  e.g. [ 100 ], input \'*2\', result becomes [ 200 ]\nUse +- to subtract.\n");
 
+                ImGui::Checkbox("Is Filled", &isCircleChecked);
+
                 if (curr_radius < 2) {
                     ImGui::Text("Circle's radius isn't less than 2");
                 }
                 else {
-                    if (curr_radius != radius) {
-                        circleData.clear();
-                        circleData = Bresenham::genCircleData(origin, curr_radius);
+                    if (curr_radius != radius || isCircleChecked != isCircleFilled) {
                         radius = curr_radius;
-                        pointData2vao(VAO[1], VBO[1], Utils::scrCoor2glCoor(circleData, scr_width, scr_height));
+                        isCircleFilled = isCircleChecked;
+                        updateCircle(scr_width, scr_height);
                     }
                 }
                 break;
@@ -201,22 +341,66 @@ int main()
             ImGui::End();
         }
 
+        // Vertex dragging in triangle mode, unless the mouse is over the menu
+        if (mode == 0 && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS && !io.WantCaptureMouse) {
+            double xpos, ypos;
+            int win_width, win_height;
+            glfwGetCursorPos(window, &xpos, &ypos);
+            glfwGetWindowSize(window, &win_width, &win_height);
+            // Window coordinates have y down, screen coordinates put (0, 0) at the center with y up
+            const int px = int(std::floor(xpos * scr_width / std::max(win_width, 1)));
+            const int py = scr_height - 1 - int(std::floor(ypos * scr_height / std::max(win_height, 1)));
+            const float x = float(px - scr_width / 2);
+            const float y = float(py - scr_height / 2);
+            if (draggedVertex < 0) {
+                // Pick the closest vertex within 10 pixels
+                float best = 100.0f;
+                for (int k = 0; k < 3; ++k) {
+                    const float dx = tri2dVex[2 * k] - x, dy = tri2dVex[2 * k + 1] - y;
+                    if (dx * dx + dy * dy < best) {
+                        best = dx * dx + dy * dy;
+                        draggedVertex = k;
+                    }
+                }
+            }
+            else if (tri2dVex[2 * draggedVertex] != x || tri2dVex[2 * draggedVertex + 1] != y) {
+                moveVertex(draggedVertex, x, y, scr_width, scr_height);
+            }
+        }
+        else {
+            draggedVertex = -1;
+        }
+
         // Rendering
         glClearColor(1.0, 1.0, 1.0, 1.0);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        my_shader.use();
-        switch (mode) {
-        case 0:
-            glBindVertexArray(VAO[mode]);
-            glDrawArrays(GL_POINTS, 0, triData.size() / 3);
-            break;
-        case 1:
+        if (isTextureMode) {
+            if (isFramebufferStale) {
+                redrawFramebuffer();
+            }
+            fbTexture.upload(fb);
+            fbTexture.draw(texture_shader);
+        }
+        else {
+            packed_shader.use();
+            packed_shader.setFloat2("viewport", float(scr_width), float(scr_height));
             glBindVertexArray(VAO[mode]);
-            glDrawArrays(GL_POINTS, 0, circleData.size() / 3);
-            break;
-        default:
-            break;
+            glDrawArrays(GL_POINTS, 0, vertexCount[mode]);
+
+            my_shader.use();
+            switch (mode) {
+            case 0:
+                glBindVertexArray(VAO[2]);
+                glDrawArrays(GL_LINES, 0, vertexCount[2]);
+                break;
+            case 1:
+                glBindVertexArray(VAO[3]);
+                glDrawArrays(GL_LINES, 0, vertexCount[3]);
+                break;
+            default:
+                break;
+            }
         }
 
         if (show_demo_window)
@@ -234,6 +418,11 @@ int main()
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     // Cleanup
+    // The stream buffers delete their fences and buffers with GL calls, not after glfwTerminate()
+    for (int i = 0; i < 4; ++i) {
+        VBO[i].release();
+    }
+    fbTexture.release();
     ImGui_ImplGlfwGL3_Shutdown();
     ImGui::DestroyContext();
     glfwTerminate();
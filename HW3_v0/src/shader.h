@@ -23,6 +23,7 @@ public:
     void setBool(const std::string &name, bool value) const;
     void setInt(const std::string &name, int value) const;
     void setFloat(const std::string &name, float value) const;
+    void setFloat2(const std::string &name, float x, float y) const;
 
     void setFloat4(const std::string &name, const float vec[]) const;
 };
@@ -0,0 +1,364 @@
+// Standalone benchmark for the rasterizers in OnlyPoints.h, CircleCache.h and Shading.h (no GL needed).
+//
+//   g++ -O2 -std=c++14 -pthread -I../src bench.cpp -o bench
+//   ./bench [results.csv] [--quick]
+//
+// Every case is timed through the vector-returning API and through the
+// output-iterator API writing into a reused buffer. Results are printed as a
+// table and written as CSV so runs from different commits can be diffed.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include "OnlyPoints.h"
+#include "CircleCache.h"
+#include "LineBatch.h"
+#include "Shading.h"
+
+// Count every heap allocation made by the process
+static std::atomic<size_t> allocationCount(0);
+
+// GCC sees through the inlined operator new to malloc and flags the matching free as mismatched
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+namespace Bench {
+    struct Result {
+        std::string kernel, api, params;
+        size_t calls, pixels;
+        double nsPerCall, nsPerPixel, allocsPerCall;
+    };
+
+    double minSeconds = 0.05;
+    std::vector<Result> results;
+    // Keeps the optimizer from dropping the work
+    volatile float sink = 0.0f;
+
+    // Runs func until minSeconds have passed; pixels is the output size of one call
+    template <typename Func>
+    void run(const char* kernel, const char* api, const std::string& params, const size_t pixels, Func func) {
+        func();
+        typedef std::chrono::steady_clock Clock;
+        size_t calls = 0, batch = 1;
+        size_t allocs = allocationCount.load();
+        Clock::time_point start = Clock::now();
+        double elapsed = 0.0;
+        while (elapsed < minSeconds) {
+            for (size_t i = 0; i < batch; ++i) func();
+            calls += batch;
+            batch *= 2;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        allocs = allocationCount.load() - allocs;
+
+        Result r;
+        r.kernel = kernel;
+        r.api = api;
+        r.params = params;
+        r.calls = calls;
+        r.pixels = pixels;
+        r.nsPerCall = elapsed * 1e9 / calls;
+        r.nsPerPixel = pixels ? r.nsPerCall / pixels : 0.0;
+        r.allocsPerCall = double(allocs) / calls;
+        results.push_back(r);
+        std::printf("%-16s %-8s %-28s %10zu px %12.1f ns/call %8.3f ns/px %6.2f allocs\n",
+            kernel, api, params.c_str(), pixels, r.nsPerCall, r.nsPerPixel, r.allocsPerCall);
+    }
+
+    // Times both APIs of a generator; genInto(out) writes through an output iterator
+    template <typename Size, typename GenVector, typename GenInto>
+    void runBoth(const char* kernel, const std::string& params, Size size, GenVector genVector, GenInto genInto) {
+        const size_t floats = size();
+        std::vector<float> buffer(floats);
+        run(kernel, "vector", params, floats / 3, [&]() {
+            std::vector<float> v = genVector();
+            sink = v.empty() ? 0.0f : v.back();
+        });
+        // The buffer is sized once, the way a caller reusing it across frames would
+        run(kernel, "into", params, floats / 3, [&]() {
+            genInto(buffer.data());
+            sink = buffer.empty() ? 0.0f : buffer.back();
+        });
+    }
+
+    void lines(const bool quick) {
+        const float PI = 3.14159265f;
+        const int lengths[] = { 8, 64, 512, 4096 };
+        // 16 directions, offset so that every octant gets two distinct slopes
+        const int directions = quick ? 8 : 16;
+        for (int len : lengths) {
+            for (int d = 0; d < directions; ++d) {
+                const float angle = (d + 0.3f) * 2.0f * PI / directions;
+                const Point v0(0.0f, 0.0f);
+                const Point v1(std::round(len * std::cos(angle)), std::round(len * std::sin(angle)));
+                const int octant = int(angle / (PI / 4.0f)) & 7;
+                const std::string params = "len=" + std::to_string(len) + " oct=" + std::to_string(octant)
+                    + " dir=" + std::to_string(d);
+                runBoth("genLineData", params,
+                    [&]() { return Bresenham::lineDataSize(v0, v1); },
+                    [&]() { return Bresenham::genLineData(v0, v1); },
+                    [&](float* out) { Bresenham::genLineData(v0, v1, out); });
+            }
+        }
+    }
+
+    void circles(const bool quick) {
+        const Point origin(0.0f, 0.0f);
+        CircleCache cache;
+        for (int R = 2; R <= 4096; R *= quick ? 4 : 2) {
+            const std::string params = "r=" + std::to_string(R);
+            runBoth("genCircleData", params,
+                [&]() { return Bresenham::circleDataSize(R); },
+                [&]() { return Bresenham::genCircleData(origin, R); },
+                [&](float* out) { Bresenham::genCircleData(origin, R, out); });
+            // Warm cache, the origin moves every call like stamping many circles of one radius
+            float shift = 0.0f;
+            runBoth("CircleCache", params,
+                [&]() { return cache.circleDataSize(R); },
+                [&]() { shift += 1.0f; return cache.genCircleData(Point(shift, -shift), R); },
+                [&](float* out) { shift += 1.0f; cache.genCircleData(Point(shift, -shift), R, out); });
+        }
+    }
+
+    // Ellipses and arcs, against the polyline of short genLineData segments they replace
+    void curves(const bool quick) {
+        const double PI = 3.14159265358979;
+        const Point origin(0.0f, 0.0f);
+        for (int R = 8; R <= 2048; R *= quick ? 16 : 4) {
+            const int ry = std::max(R / 3, 1);
+            const std::string params = "rx=" + std::to_string(R) + " ry=" + std::to_string(ry);
+            runBoth("genEllipseData", params,
+                [&]() { return Bresenham::ellipseDataSize(R, ry); },
+                [&]() { return Bresenham::genEllipseData(origin, R, ry); },
+                [&](float* out) { Bresenham::genEllipseData(origin, R, ry, out); });
+
+            // Three quarters of the curve, the start and the end fall inside octants
+            const double start = 0.3, end = 0.3 + 1.5 * PI;
+            const std::string arcParams = "r=" + std::to_string(R) + " sweep=3pi/2";
+            runBoth("genArcData", arcParams,
+                [&]() { return Bresenham::arcDataSize(R, start, end); },
+                [&]() { return Bresenham::genArcData(origin, R, start, end); },
+                [&](float* out) { Bresenham::genArcData(origin, R, start, end, out); });
+            runBoth("genEllipseArc", params + " sweep=3pi/2",
+                [&]() { return Bresenham::ellipseArcDataSize(R, ry, start, end); },
+                [&]() { return Bresenham::genEllipseArcData(origin, R, ry, start, end); },
+                [&](float* out) { Bresenham::genEllipseArcData(origin, R, ry, start, end, out); });
+
+            // The old way: 256 chords through genLineData
+            const int chords = 256;
+            std::vector<Point> polyline;
+            for (int i = 0; i <= chords; ++i) {
+                const double t = start + (end - start) * i / chords;
+                polyline.push_back(Point(float(R * std::cos(t)), float(ry * std::sin(t))));
+            }
+            size_t floats = 0;
+            for (int i = 0; i < chords; ++i) {
+                floats += Bresenham::lineDataSize(polyline[i], polyline[i + 1]);
+            }
+            run("polylineArc", "vector", params + " chords=256", floats / 3, [&]() {
+                size_t total = 0;
+                for (int i = 0; i < chords; ++i) {
+                    total += Bresenham::genLineData(polyline[i], polyline[i + 1]).size();
+                }
+                sink = float(total);
+            });
+        }
+    }
+
+    void triangles(const bool quick) {
+        const int sizes[] = { 8, 64, 512, 2048 };
+        const int aspects[] = { 1, 4, 16 };
+        for (int size : sizes) {
+            for (int aspect : aspects) {
+                if (quick && aspect == 4) continue;
+                // Base along x, apex off-centre so no edge is axis aligned
+                const float w = float(size), h = float(size / aspect > 1 ? size / aspect : 1);
+                const Point p0(-w / 2, -h / 2), p1(w / 2, -h / 3), p2(w / 5, h / 2);
+                const std::string params = "size=" + std::to_string(size) + " aspect=" + std::to_string(aspect);
+                runBoth("edgeEquations", params,
+                    [&]() { return TriangleRasterization::edgeEquationsSize(p0, p1, p2); },
+                    [&]() { return TriangleRasterization::edgeEquations(p0, p1, p2); },
+                    [&](float* out) { TriangleRasterization::edgeEquations(p0, p1, p2, out); });
+                runBoth("genTriangleData", params,
+                    [&]() { return Bresenham::triangleDataSize(p0, p1, p2, false); },
+                    [&]() { return Bresenham::genTriangleData(p0, p1, p2, false); },
+                    [&](float* out) { Bresenham::genTriangleData(p0, p1, p2, false, out); });
+            }
+            // A diagonal sliver, most of its bbox is empty
+            const float w = float(size) / 2;
+            const Point s0(-w, -w), s1(w, w), s2(-w + std::max(w / 16, 1.0f), -w);
+            runBoth("edgeEquations", "size=" + std::to_string(size) + " sliver",
+                [&]() { return TriangleRasterization::edgeEquationsSize(s0, s1, s2); },
+                [&]() { return TriangleRasterization::edgeEquations(s0, s1, s2); },
+                [&](float* out) { TriangleRasterization::edgeEquations(s0, s1, s2, out); });
+        }
+    }
+
+    // Many short segments at once, one genLineData call per segment against LineBatch
+    void lineBatch(const bool quick) {
+        const int count = quick ? 20000 : 200000;
+        LineBatch::Segments segments;
+        segments.reserve(count);
+        unsigned seed = 1;
+        auto random = [&seed](const int range) {
+            seed = seed * 1664525u + 1013904223u;
+            return float(int(seed >> 8) % (2 * range) - range);
+        };
+        for (int i = 0; i < count; ++i) {
+            const Point v0(random(400), random(300));
+            segments.push_back(v0, Point(v0.x + random(32), v0.y + random(32)));
+        }
+
+        const std::string params = "segments=" + std::to_string(count);
+        std::vector<float> data;
+        std::vector<size_t> offsets;
+        LineBatch::genLineData(segments, data, offsets, 1);
+        const size_t pixels = data.size() / 3;
+        run("lineLoop", "vector", params, pixels, [&]() {
+            size_t total = 0;
+            for (size_t i = 0; i < segments.size(); ++i) {
+                total += Bresenham::genLineData(segments.start(i), segments.end(i)).size();
+            }
+            sink = float(total);
+        });
+        for (unsigned threads : { 1u, 0u }) {
+            run("LineBatch", threads == 1 ? "1 thread" : "all", params, pixels, [&]() {
+                LineBatch::genLineData(segments, data, offsets, threads);
+                sink = data.empty() ? 0.0f : data.back();
+            });
+        }
+    }
+
+    // Star polygons through the scanline filler, against the same star as a triangle fan
+    void polygons(const bool quick) {
+        const float PI = 3.14159265f;
+        const int points[] = { 5, 32, 256 };
+        for (int n : points) {
+            if (quick && n == 32) continue;
+            std::vector<Point> star, fan;
+            for (int i = 0; i < 2 * n; ++i) {
+                const float r = (i & 1) ? 120.0f : 250.0f;
+                const float angle = i * PI / n;
+                star.push_back(Point(std::round(r * std::cos(angle)), std::round(r * std::sin(angle))));
+            }
+            for (int i = 0; i < 2 * n; ++i) {
+                fan.push_back(Point(0.0f, 0.0f));
+                fan.push_back(star[i]);
+                fan.push_back(star[(i + 1) % (2 * n)]);
+            }
+            const std::string params = "star n=" + std::to_string(n);
+            const bbox all = Clipping::unbounded();
+            runBoth("genPolygonData", params,
+                [&]() { return PolygonRasterization::polygonDataSize(star, PolygonRasterization::EVEN_ODD, all); },
+                [&]() { return PolygonRasterization::genPolygonData(star); },
+                [&](float* out) { PolygonRasterization::genPolygonData(star, PolygonRasterization::EVEN_ODD, all, out); });
+            runBoth("meshFan", params,
+                [&]() { return TriangleRasterization::meshDataSize(fan); },
+                [&]() { return TriangleRasterization::genTriangleMeshData(fan); },
+                [&](float* out) { TriangleRasterization::genTriangleMeshData(fan, out); });
+        }
+    }
+
+    // Coverage only against perspective-correct attributes, and the depth-tested framebuffer write
+    void shading(const bool quick) {
+        const int sizes[] = { 8, 64, 512 };
+        for (int size : sizes) {
+            const float w = float(size);
+            Shading::Vertex v0 = { Point(-w / 2, -w / 2), 0.2f, 1.0f, { 1, 0, 0, 0, 0, 0, 0, 0 } };
+            Shading::Vertex v1 = { Point(w / 2, -w / 3), 0.5f, 2.0f, { 0, 1, 0, 1, 0, 0, 0, 0 } };
+            Shading::Vertex v2 = { Point(w / 5, w / 2), 0.8f, 4.0f, { 0, 0, 1, 0, 1, 0, 0, 0 } };
+            const bbox all = Clipping::unbounded();
+            const size_t pixels = TriangleRasterization::edgeEquationsSize(v0.p, v1.p, v2.p, all) / 3;
+            const std::string params = "size=" + std::to_string(size);
+            run("scanTriangle", "coverage", params, pixels, [&]() {
+                size_t total = 0;
+                TriangleRasterization::scanTriangleSpansClipped(v0.p, v1.p, v2.p, all,
+                    [&total](const int, const int x0, const int x1) { total += x1 - x0 + 1; });
+                sink = float(total);
+            });
+            for (int count : { 3, 8 }) {
+                if (quick && count == 8) continue;
+                run("scanTriangle", count == 3 ? "attr=3" : "attr=8", params, pixels, [&]() {
+                    float total = 0.0f;
+                    Shading::scanTriangle(v0, v1, v2, count, all,
+                        [&total](const int, const int, const float z, const float* attr) { total += z + attr[0]; });
+                    sink = total;
+                });
+            }
+            Framebuffer target(size + 2, size + 2);
+            DepthBuffer depth(size + 2, size + 2);
+            run("drawTriangle", "depth", params, pixels, [&]() {
+                depth.clear();
+                Shading::drawTriangle(target, depth, v0, v1, v2);
+                sink = float(target.pixels[target.pixels.size() / 2]);
+            });
+        }
+    }
+
+    bool writeCSV(const char* path) {
+        FILE* f = std::fopen(path, "w");
+        if (!f) return false;
+        std::fprintf(f, "kernel,api,params,calls,pixels_per_call,ns_per_call,ns_per_pixel,allocs_per_call\n");
+        for (const Result& r : results) {
+            std::fprintf(f, "%s,%s,%s,%zu,%zu,%.2f,%.4f,%.3f\n", r.kernel.c_str(), r.api.c_str(),
+                r.params.c_str(), r.calls, r.pixels, r.nsPerCall, r.nsPerPixel, r.allocsPerCall);
+        }
+        std::fclose(f);
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const char* csvPath = "bench_results.csv";
+    bool quick = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) quick = true;
+        else csvPath = argv[i];
+    }
+    if (quick) Bench::minSeconds = 0.01;
+
+    Bench::lines(quick);
+    Bench::lineBatch(quick);
+    Bench::circles(quick);
+    Bench::curves(quick);
+    Bench::triangles(quick);
+    Bench::polygons(quick);
+    Bench::shading(quick);
+
+    if (!Bench::writeCSV(csvPath)) {
+        std::fprintf(stderr, "Failed to write %s\n", csvPath);
+        return 1;
+    }
+    std::printf("Results written to %s\n", csvPath);
+    return 0;
+}
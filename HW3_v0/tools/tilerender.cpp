@@ -0,0 +1,104 @@
+// Out-of-core line rasterization of a binary segment file into a directory of PNG tiles,
+// see OutOfCore.h for the file format and the pipeline (no GL needed).
+//
+//   g++ -O2 -std=c++14 -pthread -I../src tilerender.cpp -o tilerender
+//   ./tilerender generate <segments.bin> <count> <width> <height>
+//   ./tilerender render <segments.bin> <width> <height> <outdir> [tileSize] [bandMB] [threads]
+//
+// generate writes random polylines for testing. render writes <outdir>/tile_<row>_<column>.png
+// with row 0 at the top, outdir has to exist. Covered pixels are black.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <string>
+#include "OutOfCore.h"
+#include "ImageWriter.h"
+
+int generate(const char* path, const uint64_t count, const int width, const int height) {
+    OutOfCore::SegmentFileWriter writer;
+    if (!writer.open(path)) {
+        std::fprintf(stderr, "Failed to open %s\n", path);
+        return 1;
+    }
+    unsigned seed = 1;
+    auto random = [&seed](const int range) {
+        seed = seed * 1664525u + 1013904223u;
+        return float(int(seed >> 8) % range);
+    };
+    // Random walks of 64 steps, like contour lines or GPS tracks
+    Point p(0.0f, 0.0f);
+    for (uint64_t i = 0; i < count; ++i) {
+        if (i % 64 == 0) {
+            p = Point(random(width), random(height));
+        }
+        Point q(p.x + random(33) - 16, p.y + random(33) - 16);
+        q.x = std::min(std::max(q.x, 0.0f), float(width - 1));
+        q.y = std::min(std::max(q.y, 0.0f), float(height - 1));
+        if (!writer.add(p, q)) {
+            std::fprintf(stderr, "Failed to write %s\n", path);
+            return 1;
+        }
+        p = q;
+    }
+    if (!writer.close()) {
+        std::fprintf(stderr, "Failed to write %s\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+int render(const char* path, const int width, const int height, const std::string& outdir,
+           const int tileSize, const size_t bandMB, const unsigned threads) {
+    OutOfCore::SegmentFile input;
+    if (!input.open(path)) {
+        std::fprintf(stderr, "%s is not a segment file\n", path);
+        return 1;
+    }
+    OutOfCore::Options opt(width, height);
+    opt.tileSize = tileSize;
+    opt.bandBytes = bandMB << 20;
+    opt.threads = threads;
+
+    std::atomic<int> failed(0), written(0);
+    const auto start = std::chrono::steady_clock::now();
+    const bool ok = OutOfCore::rasterize(input, opt, [&](const int column, const int row, const CoverageBuffer& tile) {
+        const std::string name = outdir + "/tile_" + std::to_string(row) + "_" + std::to_string(column) + ".png";
+        if (ImageWriter::writePNG(tile, name)) {
+            ++written;
+        }
+        else {
+            ++failed;
+        }
+    });
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!ok) {
+        std::fprintf(stderr, "Failed to map %s\n", path);
+        return 1;
+    }
+    std::printf("%llu segments, %d tiles in %.2f s\n", (unsigned long long)input.size(), written.load(), seconds);
+    if (failed > 0) {
+        std::fprintf(stderr, "Failed to write %d tiles to %s\n", failed.load(), outdir.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 6 && std::strcmp(argv[1], "generate") == 0) {
+        return generate(argv[2], std::strtoull(argv[3], NULL, 10), std::atoi(argv[4]), std::atoi(argv[5]));
+    }
+    if (argc >= 6 && std::strcmp(argv[1], "render") == 0) {
+        const int tileSize = argc > 6 ? std::atoi(argv[6]) : 256;
+        const size_t bandMB = argc > 7 ? size_t(std::atoi(argv[7])) : 64;
+        const unsigned threads = argc > 8 ? unsigned(std::atoi(argv[8])) : 0;
+        return render(argv[2], std::atoi(argv[3]), std::atoi(argv[4]), argv[5], tileSize, bandMB, threads);
+    }
+    std::fprintf(stderr,
+        "usage: %s generate <segments.bin> <count> <width> <height>\n"
+        "       %s render <segments.bin> <width> <height> <outdir> [tileSize] [bandMB] [threads]\n",
+        argv[0], argv[0]);
+    return 1;
+}
@@ -1,14 +1,29 @@
 #version 330 core
 layout (location = 0) in float t;
 
-uniform vec3 p0;
-uniform vec3 p1;
-uniform vec3 p2;
-uniform vec3 p3;
+// Keep in sync with Bezier::MAX_GPU_POINTS
+const int MAX_POINTS = 64;
 
+// Control points in window pixels, xy of every vec4 (std140 pads array elements to vec4)
+layout (std140) uniform ControlPoints
+{
+    vec4 points[MAX_POINTS];
+};
+uniform int pointCount;
+uniform vec2 screenSize;
 
 void main()
 {
-	vec3 qt = pow((1-t), 3) * p0 + 3 * t * (1-t) * (1-t) * p1 + 3 * t * t * (1-t) * p2 + t * t * t * p3;
-    gl_Position = vec4(qt.x, qt.y, qt.z, 1.0);
-}
\ No newline at end of file
+    // de Casteljau, the same lerps in the same order as Bezier::evaluate
+    vec2 q[MAX_POINTS];
+    for (int i = 0; i < pointCount; ++i) {
+        q[i] = points[i].xy;
+    }
+    for (int k = 1; k < pointCount; ++k) {
+        for (int i = 0; i < pointCount - k; ++i) {
+            q[i] = q[i] * (1 - t) + q[i + 1] * t;
+        }
+    }
+    // 归一化到[-1, 1]
+    gl_Position = vec4(2 * q[0].x / screenSize.x - 1, 1 - 2 * q[0].y / screenSize.y, 0.0, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in float t;
+// One cubic segment per instance, control points in window pixels
+layout (location = 1) in vec4 p01;
+layout (location = 2) in vec4 p23;
+
+uniform vec2 screenSize;
+
+void main()
+{
+    // de Casteljau, the same lerps in the same order as curveShader.vs
+    vec2 a = p01.xy * (1 - t) + p01.zw * t;
+    vec2 b = p01.zw * (1 - t) + p23.xy * t;
+    vec2 c = p23.xy * (1 - t) + p23.zw * t;
+    a = a * (1 - t) + b * t;
+    b = b * (1 - t) + c * t;
+    a = a * (1 - t) + b * t;
+    // 归一化到[-1, 1]
+    gl_Position = vec4(2 * a.x / screenSize.x - 1, 1 - 2 * a.y / screenSize.y, 0.0, 1.0);
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+// Width of Bezier::evaluate, define it as 1 to force the scalar loop
+#ifndef BEZIER_SIMD_WIDTH
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BEZIER_SIMD_WIDTH 4
+#else
+#define BEZIER_SIMD_WIDTH 1
+#endif
+#endif
+
+#if BEZIER_SIMD_WIDTH == 4
+#include <emmintrin.h>
+#endif
+
+// Bezier curves of any degree, given by their control points in window pixels.
+// evaluate() is de Casteljau with the same lerps, in the same order, as Shader/curveShader.vs,
+// so the CPU and the GPU put the samples at the same places.
+// tessellate() splits the curve in half until every piece is flat enough to be drawn as its
+// chord, so the number of vertices follows the curvature and the screen size of the curve
+// instead of being a fixed number of t samples.
+namespace Bezier {
+    // Maximum distance in pixels between the curve and the line strip
+    const float DEFAULT_TOLERANCE = 0.25f;
+    // 2^16 pieces at most, far below a pixel on any screen
+    const int MAX_DEPTH = 16;
+    // Size of the ControlPoints uniform block in Shader/curveShader.vs
+    const int MAX_GPU_POINTS = 64;
+
+    // One de Casteljau step, a * (1 - t) + b * t like mix() in GLSL
+    inline glm::vec2 lerp(const glm::vec2& a, const glm::vec2& b, const float t) {
+        return a * (1.0f - t) + b * t;
+    }
+
+    glm::vec2 evaluate(const std::vector<glm::vec2>& points, const float t) {
+        if (points.empty()) {
+            return glm::vec2(0.0f, 0.0f);
+        }
+        std::vector<glm::vec2> q(points);
+        for (size_t k = 1; k < q.size(); ++k) {
+            for (size_t i = 0; i < q.size() - k; ++i) {
+                q[i] = lerp(q[i], q[i + 1], t);
+            }
+        }
+        return q[0];
+    }
+
+    // out[i] is the point of the curve at ts[i], four values of t at a time
+    void evaluate(const std::vector<glm::vec2>& points, const std::vector<float>& ts, std::vector<glm::vec2>& out) {
+        out.resize(ts.size());
+        size_t i = 0;
+#if BEZIER_SIMD_WIDTH == 4
+        const size_t n = points.size();
+        if (n > 0) {
+            // q[8 k + j] and q[8 k + 4 + j] are x and y of control point k of the curve at ts[i + j]
+            std::vector<float> q(8 * n);
+            for (; i + 4 <= ts.size(); i += 4) {
+                const __m128 t = _mm_loadu_ps(&ts[i]);
+                const __m128 s = _mm_sub_ps(_mm_set1_ps(1.0f), t);
+                for (size_t k = 0; k < n; ++k) {
+                    _mm_storeu_ps(&q[8 * k], _mm_set1_ps(points[k].x));
+                    _mm_storeu_ps(&q[8 * k + 4], _mm_set1_ps(points[k].y));
+                }
+                for (size_t k = 1; k < n; ++k) {
+                    for (size_t j = 0; j < n - k; ++j) {
+                        float* a = &q[8 * j];
+                        const float* b = &q[8 * j + 8];
+                        _mm_storeu_ps(a, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a), s), _mm_mul_ps(_mm_loadu_ps(b), t)));
+                        _mm_storeu_ps(a + 4, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + 4), s), _mm_mul_ps(_mm_loadu_ps(b + 4), t)));
+                    }
+                }
+                for (int j = 0; j < 4; ++j) {
+                    out[i + j] = glm::vec2(q[j], q[4 + j]);
+                }
+            }
+        }
+#endif
+        for (; i < ts.size(); ++i) {
+            out[i] = evaluate(points, ts[i]);
+        }
+    }
+
+    // The curve minus its chord, both parametrized by t, is the curve of the control points
+    // minus the points spread evenly on the chord, so it stays within the largest of those
+    // distances (convex hull property).
+    bool isFlat(const std::vector<glm::vec2>& points, const float tolerance) {
+        const size_t n = points.size() - 1;
+        const glm::vec2& first = points.front();
+        const glm::vec2& last = points.back();
+        for (size_t i = 1; i < n; ++i) {
+            const glm::vec2 d = points[i] - lerp(first, last, float(i) / n);
+            if (d.x * d.x + d.y * d.y > tolerance * tolerance) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Append the end points of the flat pieces of the curve, the first point excluded
+    void subdivide(const std::vector<glm::vec2>& points, const float tolerance, const int depth,
+                   std::vector<glm::vec2>& out) {
+        if (depth >= MAX_DEPTH || isFlat(points, tolerance)) {
+            out.push_back(points.back());
+            return;
+        }
+        // de Casteljau at t = 1/2: the left edge of the triangle is the first half,
+        // the right edge the second half
+        const size_t n = points.size();
+        std::vector<glm::vec2> left(n), right(points);
+        for (size_t k = 0; k < n; ++k) {
+            left[k] = right[0];
+            for (size_t i = 0; i + 1 < n - k; ++i) {
+                right[i] = (right[i] + right[i + 1]) * 0.5f;
+            }
+        }
+        // right[i] is the last point of level n - 1 - i, which is the second half in order
+        subdivide(left, tolerance, depth + 1, out);
+        subdivide(right, tolerance, depth + 1, out);
+    }
+
+    // Replace out by the line strip of the curve, control points and tolerance in pixels
+    void tessellate(const std::vector<glm::vec2>& points, const float tolerance, std::vector<glm::vec2>& out) {
+        out.clear();
+        if (points.empty()) {
+            return;
+        }
+        out.push_back(points.front());
+        if (points.size() > 1) {
+            subdivide(points, std::max(tolerance, 1e-3f), 0, out);
+        }
+    }
+}
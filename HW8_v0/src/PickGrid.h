@@ -0,0 +1,105 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+// Uniform grid over the control points for picking with the mouse. Every cell keeps the
+// indices of the points inside it, so a query only looks at the cells its circle overlaps
+// instead of every point. Cells are created on demand, points may be anywhere.
+// The grid stores indices into the caller's point array and has to be told about every
+// change to it: insert() after push_back, move() after a point moved, erase() with the
+// vector erase.
+class PickGrid
+{
+public:
+    explicit PickGrid(const float _cellSize = 16.0f) : cellSize(_cellSize) {}
+
+    void clear() {
+        cells.clear();
+    }
+
+    void insert(const int index, const glm::vec3& pos) {
+        cells[key(pos)].push_back(index);
+    }
+
+    // Nothing to do unless the point went to another cell
+    void move(const int index, const glm::vec3& from, const glm::vec3& to) {
+        const int64_t a = key(from), b = key(to);
+        if (a != b) {
+            removeFrom(a, index);
+            cells[b].push_back(index);
+        }
+    }
+
+    // The indices after index go down by one like the vector's, that visits every cell
+    void erase(const int index, const glm::vec3& pos) {
+        removeFrom(key(pos), index);
+        for (auto& cell : cells) {
+            for (int& i : cell.second) {
+                if (i > index) {
+                    --i;
+                }
+            }
+        }
+    }
+
+    // Index of the point of points nearest to (x, y) with a squared distance below
+    // squaredRadius, -1 if there is none. Of equally near points the last one wins.
+    int nearest(const std::vector<glm::vec3>& points, const float x, const float y, const float squaredRadius) const {
+        const float radius = std::sqrt(squaredRadius);
+        const int cx0 = cellOf(x - radius), cx1 = cellOf(x + radius);
+        const int cy0 = cellOf(y - radius), cy1 = cellOf(y + radius);
+        int res = -1;
+        float best = squaredRadius;
+        for (int cy = cy0; cy <= cy1; ++cy) {
+            for (int cx = cx0; cx <= cx1; ++cx) {
+                auto cell = cells.find(key(cx, cy));
+                if (cell == cells.end()) {
+                    continue;
+                }
+                for (const int i : cell->second) {
+                    const float dx = x - points[i].x;
+                    const float dy = y - points[i].y;
+                    const float d = dx * dx + dy * dy;
+                    if (d < best || (d == best && res >= 0 && i > res)) {
+                        best = d;
+                        res = i;
+                    }
+                }
+            }
+        }
+        return res;
+    }
+
+private:
+    float cellSize;
+    std::unordered_map<int64_t, std::vector<int>> cells;
+
+    int cellOf(const float v) const {
+        return int(std::floor(v / cellSize));
+    }
+
+    // Shift as unsigned, shifting a negative cx is undefined
+    static int64_t key(const int cx, const int cy) {
+        return int64_t((uint64_t(uint32_t(cx)) << 32) | uint32_t(cy));
+    }
+
+    int64_t key(const glm::vec3& pos) const {
+        return key(cellOf(pos.x), cellOf(pos.y));
+    }
+
+    void removeFrom(const int64_t k, const int index) {
+        auto cell = cells.find(k);
+        if (cell == cells.end()) {
+            return;
+        }
+        std::vector<int>& v = cell->second;
+        v.erase(std::remove(v.begin(), v.end(), index), v.end());
+        if (v.empty()) {
+            cells.erase(cell);
+        }
+    }
+};
@@ -1,7 +1,11 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
+// aPos is in window pixels, y down
+uniform vec2 screenSize;
+
 void main()
 {
-    gl_Position = vec4(aPos.x, aPos.y, aPos.z, 1.0);
-}
\ No newline at end of file
+    // 归一化到[-1, 1]
+    gl_Position = vec4(2 * aPos.x / screenSize.x - 1, 1 - 2 * aPos.y / screenSize.y, aPos.z, 1.0);
+}
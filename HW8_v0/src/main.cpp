@@ -7,6 +7,9 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include "Shader.h"
+#include "StreamBuffer.h"
+#include "Bezier.h"
+#include "PickGrid.h"
 
 #include <iostream>
 #include <cmath>
@@ -25,6 +28,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow *window);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 bool isNeedControlPoints();
+void markPointsDirty(const int first, const int last);
 vector<glm::vec3>::iterator findPointCanControlled(const float xpos, const float ypos, const float threshold);
 
 static void glfw_error_callback(int error, const char* description)
@@ -36,9 +40,25 @@ static void glfw_error_callback(int error, const char* description)
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// How the curve is drawn
+const int CURVE_ADAPTIVE = 0;   // CPU, adaptive line strip
+const int CURVE_GPU = 1;        // GPU, de Casteljau of CURVE_SAMPLES + 1 values of t
+const int CURVE_SIMD = 2;       // CPU, the same samples with Bezier::evaluate
+const int CURVE_INSTANCED = 3;  // GPU, a path of cubic segments p[3k] .. p[3k + 3], one instance each
+const int CURVE_SAMPLES = 1000;
+const int SEGMENT_SAMPLES = 32;
+
 // Global value
+// 控制点, in window pixels, as many as the user wants
 vector<glm::vec3> p;
-vector<glm::vec3>::iterator currPointIter;
+// Finds the point under the cursor, kept up to date with every change to p
+PickGrid pickGrid;
+// Index of the point being dragged, -1 if none
+int currPoint = -1;
+// Points [dirtyFirst, dirtyLast) of p changed since they were last uploaded
+int dirtyFirst = 0, dirtyLast = 0;
+// Some point changed since the curve was last built
+bool curveDirty = true;
 bool isLeftButtonPressed = false;
 
 int main()
@@ -78,44 +98,76 @@ int main()
     }
 
     // 创造着色器程序
+    // curveShader evaluates the curve from t, stripShader draws a line strip made on the CPU
     Shader curveShader(".\\Shader\\curveShader.vs", ".\\Shader\\curveShader.fs");
+    Shader stripShader(".\\Shader\\pointShader.vs", ".\\Shader\\curveShader.fs");
+    Shader instancedShader(".\\Shader\\instancedCurve.vs", ".\\Shader\\curveShader.fs");
     Shader pointShader(".\\Shader\\pointShader.vs", ".\\Shader\\pointShader.fs");
 
     // 生成顶点数据 t
-    float step = 0.001;
-    vector<float> data;
-    data.resize(int(1 / step));
-    for (int i = 0; i < data.size(); ++i) {
-        data[i] = i * step;
+    vector<float> data(CURVE_SAMPLES + 1);
+    for (int i = 0; i <= CURVE_SAMPLES; ++i) {
+        data[i] = float(i) / CURVE_SAMPLES;
     }
-
-    // 所有任务的VBO构建
-    GLuint VAO;
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-    GLuint VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    GLuint tVAO;
+    glGenVertexArrays(1, &tVAO);
+    glBindVertexArray(tVAO);
+    GLuint tVBO;
+    glGenBuffers(1, &tVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, tVBO);
     glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), data.data(), GL_STATIC_DRAW);
     glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, 1 * sizeof(GLfloat), (void*)0);
     glEnableVertexAttribArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 
-    // 设置 4 control points
-    GLfloat points[] = {
-        -0.5f, -0.5f, 0.0f,
-        -0.2f, 0.1f, 0.0f,
-        0.2f, 0.4f, 0.0f,
-        0.5f, -0.2f, 0.0f
-    };
-    p.clear();
-    p.resize(4);
-    currPointIter = p.end();
-
-    for (int i = 0; i < 4; ++i) {
-        p[i] = glm::vec3(-100.0f, -100.0f, -100.0f);
+    // Every cubic segment is drawn from the same t, with its control points from segmentVBO
+    vector<float> segmentData(SEGMENT_SAMPLES + 1);
+    for (int i = 0; i <= SEGMENT_SAMPLES; ++i) {
+        segmentData[i] = float(i) / SEGMENT_SAMPLES;
     }
+    GLuint segmentVAO;
+    glGenVertexArrays(1, &segmentVAO);
+    glBindVertexArray(segmentVAO);
+    GLuint segmentTVBO;
+    glGenBuffers(1, &segmentTVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, segmentTVBO);
+    glBufferData(GL_ARRAY_BUFFER, segmentData.size() * sizeof(GLfloat), segmentData.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, 1 * sizeof(GLfloat), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    StreamBuffer segmentVBO;
+    int segments = 0;
+    // Draw the path this many times to see how many segments a frame can take
+    int copies = 1;
+    int stripCopies = 0;
+
+    // The control points of curveShader, binding point 0
+    GLuint UBO;
+    glGenBuffers(1, &UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferData(GL_UNIFORM_BUFFER, Bezier::MAX_GPU_POINTS * sizeof(glm::vec4), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, UBO);
+    glUniformBlockBinding(curveShader.ID, glGetUniformBlockIndex(curveShader.ID, "ControlPoints"), 0);
+
+    // 曲线的 line strip, 只在控制点移动后重新计算
+    GLuint VAO;
+    glGenVertexArrays(1, &VAO);
+    StreamBuffer VBO;
+    int curveMode = CURVE_ADAPTIVE;
+    float tolerance = Bezier::DEFAULT_TOLERANCE;
+    vector<glm::vec2> strip;
+    // Vertices of the GL_LINE_STRIP draw, the GPU mode has no strip on the CPU side
+    GLsizei curveVertexCount = 0;
+    // The settings the strip or the uniform block was made with
+    float stripTolerance = 0.0f;
+    int stripMode = -1;
+
+    p.clear();
+    pickGrid.clear();
+    currPoint = -1;
 
 #ifdef IMGUI
     // Imgui 的设置
@@ -123,6 +175,8 @@ int main()
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
     ImGui_ImplGlfwGL3_Init(window, true);
+    // Init installed the ImGui callback over ours, mouse_button_callback passes the events on
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
 
     // Setup style
     //ImGui::StyleColorsDark();
@@ -133,9 +187,20 @@ int main()
     bool show_demo_window = false;
     float col1[3] = { 1.0f, 0.5f, 0.2f };
 
-    GLuint pVAO, pVBO;
+    // The control points stay on the GPU as they are in p, in window pixels. Only the points
+    // marked dirty are uploaded again, pointShader.vs normalizes them.
+    GLuint pVAO;
     glGenVertexArrays(1, &pVAO);
+    glBindVertexArray(pVAO);
+    GLuint pVBO;
     glGenBuffers(1, &pVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, pVBO);
+    int pCapacity = 64;
+    glBufferData(GL_ARRAY_BUFFER, pCapacity * sizeof(glm::vec3), NULL, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
 
     // render loop
     // -----------
@@ -162,10 +227,27 @@ int main()
         // Tip: if we don't call ImGui::Begin()/ImGui::End() the widgets automatically appears in a window called "Debug".
         {
             ImGui::Begin("Menu");
-            ImGui::Text("Use left mouse button to select or move control points");
+            ImGui::Text("Use left mouse button to add or move control points");
             ImGui::Text("Use right mouse button to remove the control points");
 
             ImGui::ColorEdit3("Bezier Curve Color", col1);
+            ImGui::RadioButton("Adaptive (CPU)", &curveMode, CURVE_ADAPTIVE); ImGui::SameLine();
+            ImGui::RadioButton("de Casteljau (GPU)", &curveMode, CURVE_GPU); ImGui::SameLine();
+            ImGui::RadioButton("de Casteljau (CPU)", &curveMode, CURVE_SIMD);
+            ImGui::RadioButton("Cubic path (GPU instanced)", &curveMode, CURVE_INSTANCED);
+            if (curveMode == CURVE_ADAPTIVE) {
+                ImGui::SliderFloat("Flatness (pixels)", &tolerance, 0.05f, 4.0f);
+            }
+            if (curveMode == CURVE_GPU && p.size() > Bezier::MAX_GPU_POINTS) {
+                ImGui::Text("More than %d control points, evaluated on the CPU", Bezier::MAX_GPU_POINTS);
+            }
+            if (curveMode == CURVE_INSTANCED) {
+                ImGui::SliderInt("Copies (stress test)", &copies, 1, 20000);
+                ImGui::Text("Control points: %d, cubic segments: %d", int(p.size()), segments);
+            }
+            else {
+                ImGui::Text("Control points: %d, curve vertices: %d", int(p.size()), curveVertexCount);
+            }
 #ifdef DEBUG
             ImGui::Checkbox("Debug", &show_demo_window);
 #endif // DEBUG
@@ -178,70 +260,161 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT);
 
         // Render Control Points
-        if (isLeftButtonPressed) {
+        if (isLeftButtonPressed && currPoint >= 0) {
+            // 拖动 the point picked by mouse_button_callback
             double xpos, ypos;
             glfwGetCursorPos(window, &xpos, &ypos);
-            if (!isNeedControlPoints()) {
-                // record the selected point index
-                // 尝试进入控制模式
-                currPointIter = findPointCanControlled(xpos, ypos, 180);
-                if (currPointIter != p.end())
-                    *currPointIter = glm::vec3(xpos, ypos, 0.0f);
+            const glm::vec3 pos(xpos, ypos, 0.0f);
+            if (p[currPoint] != pos) {
+                pickGrid.move(currPoint, p[currPoint], pos);
+                p[currPoint] = pos;
+                markPointsDirty(currPoint, currPoint + 1);
             }
         }
-        glBindVertexArray(pVAO);
         glBindBuffer(GL_ARRAY_BUFFER, pVBO);
-        auto controlPoints2dataVector = []() -> vector<GLfloat> {
-            vector<GLfloat> res;
-            res.clear();
-            for (int i = 0; i < 4; ++i) {
-                if (p[i] != glm::vec3(-100.0f, -100.0f, -100.0f)) {
-                    res.push_back(p[i].x);
-                    res.push_back(p[i].y);
-                    res.push_back(p[i].z);
-                }
-            }
-            // 将数据归一化到[-1, 1]
-            // 归一化还有问题
-            for (int i = 0; i < res.size(); i = i + 3) {
-                auto norx = (2 * res[i]) / SCR_WIDTH - 1;
-                auto nory = 1 - (2 * res[i + 1]) / SCR_HEIGHT;
-                res[i] = norx;
-                res[i + 1] = nory;
-            }
-            return res;
-        };
-        auto pointData = controlPoints2dataVector();
-        glBufferData(GL_ARRAY_BUFFER, pointData.size() * sizeof(GLfloat), pointData.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
-        glEnableVertexAttribArray(0);
+        if (int(p.size()) > pCapacity) {
+            // The buffer object stays the same, so pVAO does not change
+            pCapacity = max(2 * pCapacity, int(p.size()));
+            glBufferData(GL_ARRAY_BUFFER, pCapacity * sizeof(glm::vec3), NULL, GL_DYNAMIC_DRAW);
+            markPointsDirty(0, p.size());
+        }
+        dirtyLast = min(dirtyLast, int(p.size()));
+        if (dirtyFirst < dirtyLast) {
+            glBufferSubData(GL_ARRAY_BUFFER, dirtyFirst * sizeof(glm::vec3), (dirtyLast - dirtyFirst) * sizeof(glm::vec3),
+                            &p[dirtyFirst]);
+        }
+        dirtyFirst = dirtyLast = 0;
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         pointShader.use();
+        pointShader.setVec2("screenSize", SCR_WIDTH, SCR_HEIGHT);
         glPointSize(5.0f);
-        glDrawArrays(GL_POINTS, 0, pointData.size() / 3);
+        glBindVertexArray(pVAO);
+        glDrawArrays(GL_POINTS, 0, p.size());
         glBindVertexArray(0);
 
-        auto glfwPos2nocPos = [](const glm::vec3 p) -> glm::vec3 {
-            glm::vec3 res;
-            res.x = (2 * p.x) / SCR_WIDTH - 1;
-            res.y = 1 - (2 * p.y) / SCR_HEIGHT;
-            res.z = 0.0f;
-            return res;
-        };
-
         // Render Bezier Curve
         if (!isNeedControlPoints()) {
-            curveShader.use();
-            curveShader.setVec3("p0", glfwPos2nocPos(p[0]));
-            curveShader.setVec3("p1", glfwPos2nocPos(p[1]));
-            curveShader.setVec3("p2", glfwPos2nocPos(p[2]));
-            curveShader.setVec3("p3", glfwPos2nocPos(p[3]));
-            curveShader.setFloat3("curveColor", col1);
-            glBindVertexArray(VAO);
-            glPointSize(1.0f);
-            glDrawArrays(GL_POINTS, 0, data.size());
+            // Too many points for the uniform block, fall back to the same samples on the CPU
+            const int mode = (curveMode == CURVE_GPU && p.size() > Bezier::MAX_GPU_POINTS) ? CURVE_SIMD : curveMode;
+            if (curveDirty || mode != stripMode || (mode == CURVE_ADAPTIVE && tolerance != stripTolerance) ||
+                (mode == CURVE_INSTANCED && copies != stripCopies)) {
+                curveDirty = false;
+                stripMode = mode;
+                stripTolerance = tolerance;
+                stripCopies = copies;
+                vector<glm::vec2> points;
+                points.reserve(p.size());
+                for (const glm::vec3& v : p) {
+                    points.push_back(glm::vec2(v.x, v.y));
+                }
+                if (mode == CURVE_INSTANCED) {
+                    // p0 p1 p2 p3 of every segment, the copies are shifted on a grid of 8 pixels
+                    const int pathSegments = (p.size() - 1) / 3;
+                    vector<GLfloat> segmentPoints;
+                    segmentPoints.reserve(8 * pathSegments * copies);
+                    for (int c = 0; c < copies; ++c) {
+                        const float dx = 8.0f * (c % 100);
+                        const float dy = 8.0f * (c / 100);
+                        for (int k = 0; k < pathSegments; ++k) {
+                            for (int i = 3 * k; i <= 3 * k + 3; ++i) {
+                                segmentPoints.push_back(points[i].x + dx);
+                                segmentPoints.push_back(points[i].y + dy);
+                            }
+                        }
+                    }
+                    segments = pathSegments * copies;
+                    const GLintptr segmentOffset = segmentVBO.write(segmentPoints.data(), segmentPoints.size() * sizeof(GLfloat));
+                    if (segmentOffset < 0) {
+                        // Could not map the buffer, draw nothing and try again next frame
+                        segments = 0;
+                        stripMode = -1;
+                    }
+                    else {
+                        glBindVertexArray(segmentVAO);
+                        glBindBuffer(GL_ARRAY_BUFFER, segmentVBO.buffer);
+                        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)segmentOffset);
+                        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(segmentOffset + 4 * sizeof(GLfloat)));
+                        glEnableVertexAttribArray(1);
+                        glEnableVertexAttribArray(2);
+                        glVertexAttribDivisor(1, 1);
+                        glVertexAttribDivisor(2, 1);
+                        glBindBuffer(GL_ARRAY_BUFFER, 0);
+                        glBindVertexArray(0);
+                    }
+                    strip.clear();
+                    curveVertexCount = 0;
+                }
+                else if (mode == CURVE_GPU) {
+                    // std140: every control point takes a vec4
+                    vector<glm::vec4> block;
+                    block.reserve(points.size());
+                    for (const glm::vec2& v : points) {
+                        block.push_back(glm::vec4(v.x, v.y, 0.0f, 0.0f));
+                    }
+                    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+                    glBufferSubData(GL_UNIFORM_BUFFER, 0, block.size() * sizeof(glm::vec4), block.data());
+                    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+                    strip.clear();
+                    curveVertexCount = GLsizei(data.size());
+                }
+                else {
+                    if (mode == CURVE_ADAPTIVE) {
+                        // p is in window pixels, so the tolerance is in pixels too
+                        Bezier::tessellate(points, tolerance, strip);
+                    }
+                    else {
+                        Bezier::evaluate(points, data, strip);
+                    }
+                    // In window pixels like the control points, aPos.z is 0
+                    const GLintptr stripOffset = VBO.write(strip.data(), strip.size() * sizeof(glm::vec2));
+                    if (stripOffset < 0) {
+                        // Could not map the buffer, draw nothing and try again next frame
+                        strip.clear();
+                        curveVertexCount = 0;
+                        stripMode = -1;
+                    }
+                    else {
+                        curveVertexCount = GLsizei(strip.size());
+                        glBindVertexArray(VAO);
+                        glBindBuffer(GL_ARRAY_BUFFER, VBO.buffer);
+                        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*)stripOffset);
+                        glEnableVertexAttribArray(0);
+                        glBindBuffer(GL_ARRAY_BUFFER, 0);
+                        glBindVertexArray(0);
+                    }
+                }
+            }
+            if (mode == CURVE_INSTANCED) {
+                // Every segment in one draw call
+                instancedShader.use();
+                instancedShader.setFloat3("curveColor", col1);
+                instancedShader.setVec2("screenSize", SCR_WIDTH, SCR_HEIGHT);
+                glBindVertexArray(segmentVAO);
+                glDrawArraysInstanced(GL_LINE_STRIP, 0, segmentData.size(), segments);
+            }
+            else if (mode == CURVE_GPU) {
+                curveShader.use();
+                curveShader.setFloat3("curveColor", col1);
+                curveShader.setInt("pointCount", p.size());
+                curveShader.setVec2("screenSize", SCR_WIDTH, SCR_HEIGHT);
+                glBindVertexArray(tVAO);
+                glDrawArrays(GL_LINE_STRIP, 0, curveVertexCount);
+            }
+            else {
+                stripShader.use();
+                stripShader.setFloat3("curveColor", col1);
+                stripShader.setVec2("screenSize", SCR_WIDTH, SCR_HEIGHT);
+                glBindVertexArray(VAO);
+                glDrawArrays(GL_LINE_STRIP, 0, curveVertexCount);
+            }
             glBindVertexArray(0);
         }
+        else {
+            strip.clear();
+            curveVertexCount = 0;
+            curveDirty = true;
+            segments = 0;
+        }
 
 #ifdef IMGUI
         if (show_demo_window)
@@ -260,6 +433,9 @@ int main()
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     // Cleanup
+    // The stream buffers delete their fences and buffers with GL calls, not after glfwTerminate()
+    VBO.release();
+    segmentVBO.release();
 #ifdef IMGUI
     ImGui_ImplGlfwGL3_Shutdown();
     ImGui::DestroyContext();
@@ -285,48 +461,59 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     glViewport(0, 0, width, height);
 }
 
-bool isNeedControlPoints() {
-    return find(p.begin(), p.end(), glm::vec3(-100.0f, -100.0f, -100.0f)) != p.end();
+void markPointsDirty(const int first, const int last) {
+    curveDirty = true;
+    if (dirtyFirst >= dirtyLast) {
+        dirtyFirst = first;
+        dirtyLast = last;
+    }
+    else {
+        dirtyFirst = min(dirtyFirst, first);
+        dirtyLast = max(dirtyLast, last);
+    }
 }
 
-bool isPointInVector(const float xpos, const float ypos) {
-    return find(p.begin(), p.end(), glm::vec3(xpos, ypos, 0.0f)) != p.end();
+// A curve needs two points at least
+bool isNeedControlPoints() {
+    return p.size() < 2;
 }
 
 void addPoint(const float xpos, const float ypos) {
-    auto emptyItem = find(p.begin(), p.end(), glm::vec3(-100.0f, -100.0f, -100.0f));
-    *emptyItem = glm::vec3(xpos, ypos, 0.0f);
+    p.push_back(glm::vec3(xpos, ypos, 0.0f));
+    pickGrid.insert(p.size() - 1, p.back());
+    markPointsDirty(p.size() - 1, p.size());
 }
 
 vector<glm::vec3>::iterator findPointCanControlled(const float xpos, const float ypos, const float threshold) {
-    // 粗略查找点击范围中是否有可以控制的点
-    vector<glm::vec3>::iterator  res = p.end();
-    auto dist = [&xpos, &ypos](const vector<glm::vec3>::iterator iter) -> float {
-        return pow((xpos - iter->x), 2) + pow((ypos - iter->y), 2);
-    };
-    for (auto iter = p.begin(); iter != p.end(); ++iter) {
-        auto dis = dist(iter);
-        if (dis < threshold) {
-            if (res == p.end()) { res = iter; }
-            else { res = (dist(res) < dis) ? res : iter; }
-        }
-    }
-
-    return res;
+    // 查找点击范围中最近的可以控制的点, threshold is a squared distance
+    const int res = pickGrid.nearest(p, xpos, ypos, threshold);
+    return res >= 0 ? p.begin() + res : p.end();
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
+#ifdef IMGUI
+    ImGui_ImplGlfw_MouseButtonCallback(window, button, action, mods);
+    // Clicks on the menu are not for the canvas, releases always end a drag
+    if (action == GLFW_PRESS && ImGui::GetIO().WantCaptureMouse) {
+        return;
+    }
+#endif // IMGUI
+
     double xpos, ypos;
     glfwGetCursorPos(window, &xpos, &ypos);
 
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
-        // add one point on the canvas  && move the selected points
+        // move the point under the cursor, or add one point on the canvas and move it
         if (action == GLFW_PRESS) {
             isLeftButtonPressed = true;
-            if (isNeedControlPoints() && !isPointInVector(xpos, ypos)) {
-                // add the selected point
+            auto iter = findPointCanControlled(xpos, ypos, 180);
+            if (iter != p.end()) {
+                currPoint = iter - p.begin();
+            }
+            else {
                 addPoint(xpos, ypos);
+                currPoint = p.size() - 1;
 #ifdef DEBUG
                 cout << "add point" << xpos << "  " << ypos << endl;
 #endif // DEBUG
@@ -334,7 +521,7 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
         }
 
         if (action == GLFW_RELEASE) {
-            currPointIter = p.end();
+            currPoint = -1;
             isLeftButtonPressed = false;
         }
     }
@@ -343,7 +530,17 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
         // delete one point on the canvas
         auto tempIter = findPointCanControlled(xpos, ypos, 80);
         if (tempIter != p.end()) {
-            *tempIter = glm::vec3(-100.0f, -100.0f, -100.0f);
+            const int index = tempIter - p.begin();
+            pickGrid.erase(index, *tempIter);
+            p.erase(tempIter);
+            // The points after it moved down by one
+            markPointsDirty(index, p.size());
+            if (currPoint == index) {
+                currPoint = -1;
+            }
+            else if (currPoint > index) {
+                --currPoint;
+            }
         }
     }
 }
\ No newline at end of file
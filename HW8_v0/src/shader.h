@@ -33,6 +33,10 @@ public:
     void setFloat4(const std::string &name, const float vec[]) const;
     void setMat4(const std::string &name, const float vec[]) const;
 
+    void setVec2(const std::string &name, float x, float y) const
+    {
+        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    }
     void setVec3(const std::string &name, const glm::vec3 &value) const
     {
         glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);